@@ -16,8 +16,12 @@
 
 #include "file.h"
 
+#include <fcntl.h>
 #include <stddef.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 bool ReadLine(FILE* f, std::string* s) {
 	s->clear();
@@ -33,5 +37,34 @@ bool ReadLine(FILE* f, std::string* s) {
 	}
 }
 
+MappedFile::MappedFile() : m_data(NULL), m_size(0) {
+}
 
+MappedFile::~MappedFile() {
+	close();
+}
 
+bool MappedFile::open(const char* filename) {
+	close();
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);  // The mapping keeps a reference to the file.
+	if (data == MAP_FAILED) return false;
+	m_data = static_cast<const char*>(data);
+	m_size = st.st_size;
+	return true;
+}
+
+void MappedFile::close() {
+	if (m_data != NULL) {
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+	m_data = NULL;
+	m_size = 0;
+}
@@ -17,9 +17,33 @@
 #ifndef FILE_H_
 #define FILE_H_
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string>
 
 bool ReadLine(FILE* f, std::string* s);
 
+// A read-only memory mapping of a whole file.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps a file. Returns false if the file cannot be opened or mapped.
+	bool open(const char* filename);
+	void close();
+
+	bool isOpen() const { return m_data != NULL; }
+	const char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const char* m_data;
+	size_t m_size;
+
+	// Deleted.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
 #endif /* FILE_H_ */
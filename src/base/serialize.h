@@ -0,0 +1,96 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef SERIALIZE_H_
+#define SERIALIZE_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Helpers to save plain values and vectors of them to a file and to read them back
+// from memory, e.g. from a MappedFile. Values are stored in the native byte order.
+// The Read functions advance *pos and return false if the data is invalid.
+
+template <class T>
+void WriteValue(FILE* f, const T& value) {
+	fwrite(&value, sizeof(T), 1, f);
+}
+
+template <class T>
+bool ReadValue(const char* data, size_t size, size_t* pos, T* value) {
+	if (size - *pos < sizeof(T)) return false;
+	memcpy(value, data + *pos, sizeof(T));
+	*pos += sizeof(T);
+	return true;
+}
+
+// A vector is stored as the number of elements followed by the elements.
+template <class T>
+void WriteVector(FILE* f, const std::vector<T>& v) {
+	WriteValue(f, static_cast<int>(v.size()));
+	if (!v.empty()) fwrite(&v[0], sizeof(T), v.size(), f);
+}
+
+template <class T>
+bool ReadVector(const char* data, size_t size, size_t* pos, std::vector<T>* v) {
+	int n;
+	if (!ReadValue(data, size, pos, &n)) return false;
+	if (n < 0 || (size - *pos) / sizeof(T) < static_cast<size_t>(n)) return false;
+	v->resize(n);
+	if (n > 0) memcpy(&(*v)[0], data + *pos, sizeof(T) * n);
+	*pos += sizeof(T) * n;
+	return true;
+}
+
+template <class T>
+void WriteVectors(FILE* f, const std::vector<std::vector<T> >& v) {
+	WriteValue(f, static_cast<int>(v.size()));
+	for (size_t i = 0; i < v.size(); ++i) {
+		WriteVector(f, v[i]);
+	}
+}
+
+template <class T>
+bool ReadVectors(const char* data, size_t size, size_t* pos, std::vector<std::vector<T> >* v) {
+	int n;
+	if (!ReadValue(data, size, pos, &n)) return false;
+	// Every vector takes at least its size.
+	if (n < 0 || (size - *pos) / sizeof(int) < static_cast<size_t>(n)) return false;
+	v->resize(n);
+	for (int i = 0; i < n; ++i) {
+		if (!ReadVector(data, size, pos, &(*v)[i])) return false;
+	}
+	return true;
+}
+
+inline void WriteString(FILE* f, const std::string& s) {
+	WriteValue(f, static_cast<int>(s.size()));
+	fwrite(s.data(), 1, s.size(), f);
+}
+
+inline bool ReadString(const char* data, size_t size, size_t* pos, std::string* s) {
+	int n;
+	if (!ReadValue(data, size, pos, &n)) return false;
+	if (n < 0 || size - *pos < static_cast<size_t>(n)) return false;
+	s->assign(data + *pos, n);
+	*pos += n;
+	return true;
+}
+
+#endif /* SERIALIZE_H_ */
@@ -0,0 +1,93 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "thread_pool.h"
+
+#include <unistd.h>
+
+ThreadPool::ThreadPool(int num_threads) : m_numPending(0), m_stopping(false) {
+	if (num_threads <= 0) {
+		num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (num_threads <= 0) num_threads = 1;
+	}
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_taskAdded, NULL);
+	pthread_cond_init(&m_tasksDone, NULL);
+	for (int i = 0; i < num_threads; ++i) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, &ThreadPool::threadMain, this) != 0) break;
+		m_threads.push_back(thread);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	wait();
+	pthread_mutex_lock(&m_mutex);
+	m_stopping = true;
+	pthread_cond_broadcast(&m_taskAdded);
+	pthread_mutex_unlock(&m_mutex);
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		pthread_join(m_threads[i], NULL);
+	}
+	pthread_cond_destroy(&m_tasksDone);
+	pthread_cond_destroy(&m_taskAdded);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void ThreadPool::add(ThreadTask* task) {
+	if (m_threads.empty()) {
+		// No thread could be started.
+		task->run();
+		return;
+	}
+	pthread_mutex_lock(&m_mutex);
+	m_tasks.push_back(task);
+	++m_numPending;
+	pthread_cond_signal(&m_taskAdded);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void ThreadPool::wait() {
+	pthread_mutex_lock(&m_mutex);
+	while (m_numPending > 0) {
+		pthread_cond_wait(&m_tasksDone, &m_mutex);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void* ThreadPool::threadMain(void* arg) {
+	static_cast<ThreadPool*>(arg)->runTasks();
+	return NULL;
+}
+
+void ThreadPool::runTasks() {
+	pthread_mutex_lock(&m_mutex);
+	for (;;) {
+		while (m_tasks.empty() && !m_stopping) {
+			pthread_cond_wait(&m_taskAdded, &m_mutex);
+		}
+		if (m_tasks.empty()) break;
+		ThreadTask* task = m_tasks.front();
+		m_tasks.pop_front();
+		pthread_mutex_unlock(&m_mutex);
+		task->run();
+		pthread_mutex_lock(&m_mutex);
+		if (--m_numPending == 0) {
+			pthread_cond_broadcast(&m_tasksDone);
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
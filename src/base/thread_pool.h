@@ -0,0 +1,67 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+// A unit of work for a ThreadPool.
+class ThreadTask {
+public:
+	virtual ~ThreadTask() {}
+	virtual void run() = 0;
+};
+
+// A fixed set of worker threads that run added tasks in the order they are added.
+class ThreadPool {
+public:
+	// Starts num_threads threads, or one per processor if num_threads is 0.
+	explicit ThreadPool(int num_threads = 0);
+	// Waits for the added tasks and stops the threads.
+	~ThreadPool();
+
+	int numThreads() const { return m_threads.size(); }
+
+	// Schedules a task. The task is not owned and must stay alive until it has run.
+	// Must not be called from a task.
+	void add(ThreadTask* task);
+
+	// Waits until all added tasks have finished. Must not be called from a task.
+	void wait();
+
+private:
+	static void* threadMain(void* arg);
+	void runTasks();
+
+	std::vector<pthread_t> m_threads;
+	std::deque<ThreadTask*> m_tasks;
+	// Number of tasks that are added, but not finished.
+	int m_numPending;
+	bool m_stopping;
+
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_taskAdded;
+	pthread_cond_t m_tasksDone;
+
+	// Deleted.
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+};
+
+#endif /* THREAD_POOL_H_ */
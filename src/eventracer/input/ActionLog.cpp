@@ -16,6 +16,13 @@
 
 #include "ActionLog.h"
 
+#include <string.h>
+
+#include "ActionLogWriter.h"
+#include "Varint.h"
+#include "base.h"
+#include "thread_pool.h"
+
 const char* ActionLog::CommandType_AsString(CommandType ctype) {
 	switch (ctype) {
 	case ENTER_SCOPE: return "ENTER_SCOPE";
@@ -40,13 +47,14 @@ const char* ActionLog::EventActionType_AsString(EventActionType otype) {
 }
 
 
-ActionLog::ActionLog() : m_maxEventActionId(-1), m_currentEventActionId(-1) {
+ActionLog::ActionLog()
+	: m_numUnusedCommands(0), m_mappedTypes(NULL), m_mappedLocations(NULL),
+	  m_numEventActions(0), m_maxEventActionId(-1),
+	  m_currentEventActionId(-1), m_lastEventActionId(-1),
+	  m_cmdsGeneration(1), m_numCmdsInCurrentEvent(0), m_writer(NULL) {
 }
 
 ActionLog::~ActionLog() {
-	for (std::map<int, EventAction*>::iterator it = m_eventActions.begin(); it != m_eventActions.end(); ++it) {
-		delete it->second;
-	}
 }
 
 
@@ -55,68 +63,257 @@ void ActionLog::addArc(int earlierOperation, int laterOperation, int arcDuration
 	a.m_tail = earlierOperation;
 	a.m_head = laterOperation;
 	a.m_duration = arcDuration;
+	if (m_writer != NULL) {
+		m_writer->addArc(a);
+		return;
+	}
 	m_arcs.push_back(a);
 }
 
+bool ActionLog::addEventAction(int id) {
+	if (id < 0) return false;
+	if (static_cast<size_t>(id) >= m_eventTypes.size()) {
+		m_eventTypes.resize(id + 1, NO_EVENT_ACTION);
+		m_eventMapped.resize(id + 1, false);
+		m_eventBegin.resize(id + 1, 0);
+		m_eventEnd.resize(id + 1, 0);
+	}
+	if (m_eventTypes[id] == NO_EVENT_ACTION) {
+		m_eventTypes[id] = UNKNOWN;
+		m_eventMapped[id] = false;
+		m_eventBegin[id] = m_cmdTypes.size();
+		m_eventEnd[id] = m_cmdTypes.size();
+		++m_numEventActions;
+	}
+	if (id > m_maxEventActionId) {
+		m_maxEventActionId = id;
+	}
+	return true;
+}
+
+void ActionLog::moveEventActionToEnd(int id) {
+	if (id == m_lastEventActionId) return;
+	m_lastEventActionId = id;
+	size_t begin = m_eventBegin[id];
+	size_t end = m_eventEnd[id];
+	m_eventBegin[id] = m_cmdTypes.size();
+	if (m_eventMapped[id]) {
+		m_eventMapped[id] = false;
+		m_cmdTypes.insert(m_cmdTypes.end(), m_mappedTypes + begin, m_mappedTypes + end);
+		m_cmdLocations.insert(m_cmdLocations.end(), m_mappedLocations + begin, m_mappedLocations + end);
+		m_eventEnd[id] = m_cmdTypes.size();
+		return;
+	}
+	if (begin == end) {
+		m_eventEnd[id] = m_cmdTypes.size();
+		return;
+	}
+	for (size_t i = begin; i < end; ++i) {
+		m_cmdTypes.push_back(m_cmdTypes[i]);
+		m_cmdLocations.push_back(m_cmdLocations[i]);
+	}
+	m_eventEnd[id] = m_cmdTypes.size();
+	m_numUnusedCommands += end - begin;
+}
+
+bool ActionLog::isCompact() const {
+	size_t pos = 0;
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION || m_eventMapped[id]) continue;
+		if (m_eventBegin[id] != pos) return false;
+		pos = m_eventEnd[id];
+	}
+	return pos == m_cmdTypes.size();
+}
+
+void ActionLog::compact() {
+	std::vector<unsigned char> types;
+	std::vector<int> locations;
+	types.reserve(m_cmdTypes.size() - m_numUnusedCommands);
+	locations.reserve(m_cmdTypes.size() - m_numUnusedCommands);
+	m_lastEventActionId = -1;
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION || m_eventMapped[id]) continue;
+		size_t begin = m_eventBegin[id];
+		size_t end = m_eventEnd[id];
+		m_eventBegin[id] = types.size();
+		types.insert(types.end(), m_cmdTypes.begin() + begin, m_cmdTypes.begin() + end);
+		locations.insert(locations.end(), m_cmdLocations.begin() + begin, m_cmdLocations.begin() + end);
+		m_eventEnd[id] = types.size();
+		m_lastEventActionId = id;
+	}
+	m_cmdTypes.swap(types);
+	m_cmdLocations.swap(locations);
+	m_numUnusedCommands = 0;
+}
+
 void ActionLog::startEventAction(int operation) {
-	m_currentEventActionId = operation;
-	if (m_eventActions[m_currentEventActionId] == NULL) {
-		m_eventActions[m_currentEventActionId] = new EventAction();
+	if (!addEventAction(operation)) {
+		fprintf(stderr, "Ignoring event action with negative id %d\n", operation);
+		m_currentEventActionId = -1;
+		clearCurrentEventCommands();
+		return;
 	}
-	if (operation > m_maxEventActionId) {
-		m_maxEventActionId = operation;
+	m_currentEventActionId = operation;
+	moveEventActionToEnd(operation);
+	if (m_numUnusedCommands > m_cmdTypes.size() / 2) {
+		compact();
+		moveEventActionToEnd(operation);
 	}
-	m_cmdsInCurrentEvent.clear();
+	clearCurrentEventCommands();
 }
 
 bool ActionLog::endEventAction() {
 	bool wasInOp = m_currentEventActionId != -1;
+	if (wasInOp && m_writer != NULL) {
+		int id = m_currentEventActionId;
+		m_writer->addEventAction(id, event_action(id));
+		clearEventAction(id);
+	}
 	m_currentEventActionId = -1;
-	m_cmdsInCurrentEvent.clear();
+	clearCurrentEventCommands();
 	return wasInOp;
 }
 
 bool ActionLog::setEventActionType(EventActionType op_type) {
 	if (m_currentEventActionId == -1) return false;
-	m_eventActions[m_currentEventActionId]->m_type = op_type;
+	m_eventTypes[m_currentEventActionId] = op_type;
 	return true;
 }
 
 bool ActionLog::willLogCommand(CommandType command) {
 	if (m_currentEventActionId == -1) return false;
-	std::vector<Command>& current_cmds = m_eventActions[m_currentEventActionId]->m_commands;
 	if (command == MEMORY_VALUE) {
-		if (current_cmds.size() == 0) return false;
-		Command& lastc = current_cmds[current_cmds.size() - 1];
-		if (lastc.m_cmdType != READ_MEMORY && lastc.m_cmdType != WRITE_MEMORY) {
+		size_t end = m_eventEnd[m_currentEventActionId];
+		if (end == m_eventBegin[m_currentEventActionId]) return false;
+		if (m_cmdTypes[end - 1] != READ_MEMORY && m_cmdTypes[end - 1] != WRITE_MEMORY) {
 			return false;
 		}
 	}
 	return true;
 }
 
+namespace {
+// The initial number of slots for the commands of the current event action. Must be a power of two.
+const size_t kInitialCommandSlots = 64;
+
+inline size_t CommandSlotIndex(int command, int location, size_t mask) {
+	unsigned int h = static_cast<unsigned int>(location) * 2 + command;
+	h *= 0x9e3779b1U;  // Fibonacci hashing, the locations are often consecutive.
+	return (h ^ (h >> 16)) & mask;
+}
+}  // namespace
+
+bool ActionLog::addCurrentEventCommand(CommandType command, int location) {
+	if ((m_numCmdsInCurrentEvent + 1) * 2 > m_cmdsInCurrentEvent.size()) {
+		resizeCurrentEventCommands(m_cmdsInCurrentEvent.empty() ?
+				kInitialCommandSlots : m_cmdsInCurrentEvent.size() * 2);
+	}
+	size_t mask = m_cmdsInCurrentEvent.size() - 1;
+	for (size_t i = CommandSlotIndex(command, location, mask);; i = (i + 1) & mask) {
+		CommandSlot& slot = m_cmdsInCurrentEvent[i];
+		if (slot.m_generation != m_cmdsGeneration) {
+			slot.m_generation = m_cmdsGeneration;
+			slot.m_location = location;
+			slot.m_cmdType = command;
+			++m_numCmdsInCurrentEvent;
+			return true;
+		}
+		if (slot.m_location == location && slot.m_cmdType == command) return false;
+	}
+}
+
+void ActionLog::clearCurrentEventCommands() {
+	if (m_numCmdsInCurrentEvent == 0) return;
+	m_numCmdsInCurrentEvent = 0;
+	if (++m_cmdsGeneration == 0) {
+		// The generation wrapped around, so old slots could look used again.
+		for (size_t i = 0; i < m_cmdsInCurrentEvent.size(); ++i) {
+			m_cmdsInCurrentEvent[i].m_generation = 0;
+		}
+		m_cmdsGeneration = 1;
+	}
+}
+
+void ActionLog::resizeCurrentEventCommands(size_t capacity) {
+	std::vector<CommandSlot> old_slots(capacity);
+	old_slots.swap(m_cmdsInCurrentEvent);  // The new slots have generation 0.
+	unsigned int old_generation = m_cmdsGeneration;
+	m_cmdsGeneration = 1;
+	m_numCmdsInCurrentEvent = 0;
+	for (size_t i = 0; i < old_slots.size(); ++i) {
+		if (old_slots[i].m_generation == old_generation) {
+			addCurrentEventCommand(static_cast<CommandType>(old_slots[i].m_cmdType), old_slots[i].m_location);
+		}
+	}
+}
+
 bool ActionLog::logCommand(CommandType command, int memoryLocation) {
 	if (m_currentEventActionId == -1) return false;
 	if (!willLogCommand(command)) return true;
-	Command c;
-	c.m_cmdType = command;
-	c.m_location = memoryLocation;
 	if (command == READ_MEMORY || command == WRITE_MEMORY) {
-		if (!m_cmdsInCurrentEvent.insert(c).second) {
+		if (!addCurrentEventCommand(command, memoryLocation)) {
 			return true;  // Already exists, no need to add again to the same op.
 		}
 	}
-	std::vector<Command>& current_cmds = m_eventActions[m_currentEventActionId]->m_commands;
+	// The current event action is always the last one in the command arrays.
+	size_t& end = m_eventEnd[m_currentEventActionId];
 	if (command == EXIT_SCOPE &&
-		current_cmds.size() > 0 &&
-		current_cmds[current_cmds.size() - 1].m_cmdType == ENTER_SCOPE) {
-		current_cmds.pop_back();  // Remove the last enter scope. There was nothing in it and we exit it.
+		end > m_eventBegin[m_currentEventActionId] &&
+		m_cmdTypes[end - 1] == ENTER_SCOPE) {
+		// Remove the last enter scope. There was nothing in it and we exit it.
+		m_cmdTypes.pop_back();
+		m_cmdLocations.pop_back();
+		--end;
 		return true;
 	}
-	current_cmds.push_back(c);
+	m_cmdTypes.push_back(command);
+	m_cmdLocations.push_back(memoryLocation);
+	++end;
 	return true;
 }
 
+bool ActionLog::copyEventAction(int id, const EventAction& event_action) {
+	if (m_currentEventActionId != -1) return false;
+	if (!addEventAction(id)) return false;
+	m_eventTypes[id] = event_action.m_type;
+	if (m_writer != NULL) {
+		m_writer->addEventAction(id, event_action);
+		return true;
+	}
+	moveEventActionToEnd(id);
+	const CommandSpan& cmds = event_action.m_commands;
+	m_cmdTypes.insert(m_cmdTypes.end(), cmds.types(), cmds.types() + cmds.size());
+	m_cmdLocations.insert(m_cmdLocations.end(), cmds.locations(), cmds.locations() + cmds.size());
+	m_eventEnd[id] = m_cmdTypes.size();
+	if (m_numUnusedCommands > m_cmdTypes.size() / 2) {
+		compact();
+	}
+	return true;
+}
+
+void ActionLog::clearEventAction(int id) {
+	if (!hasEventAction(id)) return;
+	if (m_eventMapped[id]) {
+		m_eventMapped[id] = false;
+		m_eventBegin[id] = m_cmdTypes.size();
+	} else if (id == m_lastEventActionId) {
+		// The commands are at the end of the command arrays, so they can be dropped.
+		m_cmdTypes.resize(m_eventBegin[id]);
+		m_cmdLocations.resize(m_eventBegin[id]);
+	} else {
+		m_numUnusedCommands += m_eventEnd[id] - m_eventBegin[id];
+	}
+	m_eventEnd[id] = m_eventBegin[id];
+}
+
+void ActionLog::setCommandLocation(int event_action_id, int command_id, int location) {
+	if (!hasEventAction(event_action_id)) return;
+	if (command_id < 0 || static_cast<size_t>(command_id) >= m_eventEnd[event_action_id] - m_eventBegin[event_action_id]) return;
+	if (m_eventMapped[event_action_id]) moveEventActionToEnd(event_action_id);
+	m_cmdLocations[m_eventBegin[event_action_id] + command_id] = location;
+}
+
 struct ActionLogHeader {
 	int num_ops;
 	int num_arcs;
@@ -128,20 +325,73 @@ struct OperationHeader {
 	int num_commands;
 };
 
+// Reads the event actions of a log in the encoding of saveToFile, one by one.
+class SavedLogReader {
+public:
+	SavedLogReader() : m_data(NULL), m_opsPos(0), m_pos(0), m_numOps(0), m_numOpsLeft(0) {}
+
+	// Checks the log and appends its arcs. Returns false if the log is invalid.
+	bool open(const char* data, size_t size, std::vector<ActionLog::Arc>* arcs) {
+		size_t end = 0;
+		if (!ActionLog::skipInMemory(data, size, &end)) return false;
+		ActionLogHeader hdr;
+		memcpy(&hdr, data, sizeof(hdr));
+		size_t num_arcs = arcs->size();
+		arcs->resize(num_arcs + hdr.num_arcs);
+		memcpy(arcs->data() + num_arcs, data + sizeof(hdr), sizeof(ActionLog::Arc) * hdr.num_arcs);
+		m_data = data;
+		m_opsPos = sizeof(hdr) + sizeof(ActionLog::Arc) * hdr.num_arcs;
+		m_numOps = hdr.num_ops;
+		rewind();
+		return true;
+	}
+
+	// Goes back to the first event action.
+	void rewind() {
+		m_pos = m_opsPos;
+		m_numOpsLeft = m_numOps;
+	}
+
+	// Reads the next event action and points commands to its commands. Returns false
+	// after the last one.
+	bool next(OperationHeader* ophdr, const char** commands) {
+		if (m_numOpsLeft <= 0) return false;
+		--m_numOpsLeft;
+		memcpy(ophdr, m_data + m_pos, sizeof(*ophdr));
+		m_pos += sizeof(*ophdr);
+		*commands = m_data + m_pos;
+		m_pos += sizeof(ActionLog::Command) * ophdr->num_commands;
+		return true;
+	}
+
+private:
+	const char* m_data;
+	size_t m_opsPos;
+	size_t m_pos;
+	int m_numOps;
+	int m_numOpsLeft;
+};
+
 void ActionLog::saveToFile(FILE* f) {
 	ActionLogHeader hdr;
 	hdr.num_arcs = m_arcs.size();
-	hdr.num_ops = m_eventActions.size();
+	hdr.num_ops = m_numEventActions;
 	fwrite(&hdr, sizeof(hdr), 1, f);
 	fwrite(m_arcs.data(), sizeof(Arc), m_arcs.size(), f);
-	for (EventActionSet::const_iterator it = m_eventActions.begin(); it != m_eventActions.end(); ++it) {
+	std::vector<Command> commands;
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
 		OperationHeader ophdr;
-		const EventAction& op = *(it->second);
-		ophdr.id = it->first;
-		ophdr.type = op.m_type;
-		ophdr.num_commands = op.m_commands.size();
+		ophdr.id = id;
+		ophdr.type = static_cast<EventActionType>(m_eventTypes[id]);
+		CommandSpan span = this->commands(id);
+		ophdr.num_commands = span.size();
+		commands.resize(ophdr.num_commands);
+		for (int i = 0; i < ophdr.num_commands; ++i) {
+			commands[i] = span[i];
+		}
 		fwrite(&ophdr, sizeof(ophdr), 1, f);
-		fwrite(op.m_commands.data(), sizeof(Command), op.m_commands.size(), f);
+		fwrite(commands.data(), sizeof(Command), commands.size(), f);
 	}
 	fflush(f);
 	printf("Action log saved.\n");
@@ -152,26 +402,705 @@ bool ActionLog::loadFromFile(FILE* f) {
 	if (fread(&hdr, sizeof(hdr), 1, f) != 1) return false;
 	m_arcs.resize(hdr.num_arcs);
 	if (fread(m_arcs.data(), sizeof(Arc), m_arcs.size(), f) != m_arcs.size()) return false;
+	std::vector<Command> commands;
 	for (int i = 0; i < hdr.num_ops; ++i) {
 		OperationHeader ophdr;
 		if (fread(&ophdr, sizeof(ophdr), 1, f) != 1) return false;
-		EventAction* op = new EventAction();
-		op->m_commands.resize(ophdr.num_commands);
-		op->m_type = ophdr.type;
-		if (fread(op->m_commands.data(), sizeof(Command), op->m_commands.size(), f) !=
-				op->m_commands.size()) {
+		commands.resize(ophdr.num_commands);
+		if (fread(commands.data(), sizeof(Command), commands.size(), f) != commands.size()) {
 			return false;
 		}
-		m_eventActions[ophdr.id] = op;
-		if (ophdr.id > m_maxEventActionId) {
-			m_maxEventActionId = ophdr.id;
+		if (!addLoadedEventAction(ophdr.id, ophdr.type,
+				reinterpret_cast<const char*>(commands.data()), ophdr.num_commands)) {
+			return false;
 		}
 	}
+	updateMaxEventActionIdFromArcs();
+	return true;
+}
+
+bool ActionLog::streamFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer) {
+	size_t begin = *pos;
+	if (!skipInMemory(data, size, pos)) return false;
+	std::vector<std::pair<const char*, size_t> > logs(1, std::pair<const char*, size_t>(data + begin, *pos - begin));
+	return streamJoinedFromMemory(logs, consumer);
+}
+
+bool ActionLog::streamJoinedFromMemory(const std::vector<std::pair<const char*, size_t> >& logs,
+		ActionLogConsumer* consumer) {
+	std::vector<Arc> arcs;
+	std::vector<SavedLogReader> readers(logs.size());
+	for (size_t i = 0; i < logs.size(); ++i) {
+		if (!readers[i].open(logs[i].first, logs[i].second, &arcs)) return false;
+	}
+	int max_event_action_id = -1;
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		if (arcs[i].m_head > max_event_action_id) max_event_action_id = arcs[i].m_head;
+		if (arcs[i].m_tail > max_event_action_id) max_event_action_id = arcs[i].m_tail;
+	}
+	consumer->consumeArcs(arcs);
+
+	std::vector<unsigned char> types;
+	std::vector<int> locations;
+	int last_id = -1;
+	for (size_t log = 0; log < readers.size(); ++log) {
+		OperationHeader ophdr;
+		const char* commands;
+		while (readers[log].next(&ophdr, &commands)) {
+			if (ophdr.id <= last_id) {
+				fprintf(stderr, "Event action %d out of order or repeated\n", ophdr.id);
+				return false;
+			}
+			last_id = ophdr.id;
+			types.resize(ophdr.num_commands);
+			locations.resize(ophdr.num_commands);
+			for (int j = 0; j < ophdr.num_commands; ++j) {
+				Command c;
+				memcpy(&c, commands + j * sizeof(Command), sizeof(Command));
+				types[j] = c.m_cmdType;
+				locations[j] = c.m_location;
+			}
+			EventAction op;
+			op.m_type = ophdr.type;
+			op.m_commands = CommandSpan(types.data(), locations.data(), ophdr.num_commands);
+			consumer->consumeEventAction(ophdr.id, op);
+		}
+	}
+	if (last_id > max_event_action_id) max_event_action_id = last_id;
+	consumer->finish(max_event_action_id);
+	return true;
+}
+
+// The compact encoding stores the locations relative to the previous location of the
+// same command type, so it keeps one previous location per possible type.
+static const int kNumCompactTypes = 16;
+
+void ActionLog::saveCompactToFile(FILE* f) {
+	std::vector<unsigned char> out;
+	AppendVarint(m_numEventActions, &out);
+	AppendVarint(m_arcs.size(), &out);
+	int prev_tail = 0;
 	for (size_t i = 0; i < m_arcs.size(); ++i) {
-		if (m_arcs[i].m_head > m_maxEventActionId) m_maxEventActionId = m_arcs[i].m_head;
-		if (m_arcs[i].m_tail > m_maxEventActionId) m_maxEventActionId = m_arcs[i].m_tail;
+		AppendVarint(ZigZagEncodeDelta(m_arcs[i].m_tail, prev_tail), &out);
+		AppendVarint(ZigZagEncodeDelta(m_arcs[i].m_head, m_arcs[i].m_tail), &out);
+		AppendVarint(m_arcs[i].m_duration + 1, &out);
+		prev_tail = m_arcs[i].m_tail;
+	}
+	fwrite(out.data(), 1, out.size(), f);
+
+	std::vector<unsigned int> deltas;
+	int prev_id = -1;
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		out.clear();
+		CommandSpan cmds = commands(id);
+		size_t n = cmds.size();
+		AppendVarint(id - prev_id - 1, &out);
+		AppendVarint(m_eventTypes[id], &out);
+		AppendVarint(n, &out);
+		prev_id = id;
+		// Types, two per byte.
+		for (size_t i = 0; i < n; i += 2) {
+			unsigned char b = cmds.types()[i] & 0xf;
+			if (i + 1 < n) b |= (cmds.types()[i + 1] & 0xf) << 4;
+			out.push_back(b);
+		}
+		// Locations.
+		int prev_location[kNumCompactTypes] = { 0 };
+		deltas.resize(n);
+		for (size_t i = 0; i < n; ++i) {
+			int type = cmds.types()[i] & 0xf;
+			deltas[i] = ZigZagEncodeDelta(cmds.location(i), prev_location[type]);
+			prev_location[type] = cmds.location(i);
+		}
+		AppendStreamVByte(deltas.data(), n, &out);
+		fwrite(out.data(), 1, out.size(), f);
+	}
+	fflush(f);
+	printf("Action log saved.\n");
+}
+
+// Reads the header and the arcs of a log in the compact encoding.
+static bool ReadCompactArcs(const unsigned char* bytes, size_t size, size_t* pos,
+		unsigned int* num_ops, std::vector<ActionLog::Arc>* arcs) {
+	unsigned int num_arcs;
+	if (!ReadVarint(bytes, size, pos, num_ops) || !ReadVarint(bytes, size, pos, &num_arcs)) return false;
+	// Every arc takes at least three bytes.
+	if (num_arcs > (size - *pos) / 3) return false;
+	arcs->resize(num_arcs);
+	int prev_tail = 0;
+	for (size_t i = 0; i < arcs->size(); ++i) {
+		unsigned int tail, head, duration;
+		if (!ReadVarint(bytes, size, pos, &tail) ||
+				!ReadVarint(bytes, size, pos, &head) ||
+				!ReadVarint(bytes, size, pos, &duration)) {
+			return false;
+		}
+		ActionLog::Arc& arc = (*arcs)[i];
+		arc.m_tail = ZigZagDecodeDelta(tail, prev_tail);
+		arc.m_head = ZigZagDecodeDelta(head, arc.m_tail);
+		arc.m_duration = static_cast<int>(duration) - 1;
+		prev_tail = arc.m_tail;
 	}
 	return true;
 }
 
+// Decodes the n commands of an event action in the compact encoding, starting at the
+// packed types. deltas must have space for n rounded up to a multiple of four.
+static bool DecodeCompactCommands(const unsigned char* bytes, size_t size, size_t* pos, size_t n,
+		unsigned char* types, int* locations, unsigned int* deltas) {
+	size_t type_bytes = (n + 1) / 2;
+	if (size - *pos < type_bytes) return false;
+	for (size_t i = 0; i < type_bytes; ++i) {
+		unsigned char b = bytes[*pos + i];
+		types[2 * i] = b & 0xf;
+		if (2 * i + 1 < n) types[2 * i + 1] = b >> 4;
+	}
+	*pos += type_bytes;
+	if (!ReadStreamVByte(bytes, size, pos, n, deltas)) return false;
+	int prev_location[kNumCompactTypes] = { 0 };
+	for (size_t i = 0; i < n; ++i) {
+		int& prev = prev_location[types[i]];
+		prev = ZigZagDecodeDelta(deltas[i], prev);
+		locations[i] = prev;
+	}
+	return true;
+}
+
+bool ActionLog::streamCompactFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	unsigned int num_ops;
+	std::vector<Arc> arcs;
+	if (!ReadCompactArcs(bytes, size, pos, &num_ops, &arcs)) return false;
+	int max_event_action_id = -1;
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		if (arcs[i].m_head > max_event_action_id) max_event_action_id = arcs[i].m_head;
+		if (arcs[i].m_tail > max_event_action_id) max_event_action_id = arcs[i].m_tail;
+	}
+	consumer->consumeArcs(arcs);
+
+	std::vector<unsigned char> types;
+	std::vector<int> locations;
+	std::vector<unsigned int> deltas;
+	int id = -1;
+	for (unsigned int op = 0; op < num_ops; ++op) {
+		unsigned int id_delta, type, n;
+		if (!ReadVarint(bytes, size, pos, &id_delta) ||
+				!ReadVarint(bytes, size, pos, &type) ||
+				!ReadVarint(bytes, size, pos, &n)) {
+			return false;
+		}
+		id += id_delta + 1;
+		// Every command takes at least one byte.
+		if (n > size - *pos) return false;
+		types.resize(n);
+		locations.resize(n);
+		deltas.resize((n + 3) / 4 * 4);
+		if (!DecodeCompactCommands(bytes, size, pos, n, types.data(), locations.data(), deltas.data())) {
+			return false;
+		}
+		EventAction event_action;
+		event_action.m_type = static_cast<EventActionType>(type);
+		event_action.m_commands = CommandSpan(types.data(), locations.data(), n);
+		consumer->consumeEventAction(id, event_action);
+	}
+	if (id > max_event_action_id) max_event_action_id = id;
+	consumer->finish(max_event_action_id);
+	return true;
+}
+
+// Loads a streamed log into an ActionLog.
+class CompactLogLoader : public ActionLogConsumer {
+public:
+	explicit CompactLogLoader(ActionLog* log) : m_log(log) {}
+
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs) {
+		m_log->m_arcs = arcs;
+	}
+
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) {
+		const ActionLog::CommandSpan& commands = event_action.m_commands;
+		if (!m_log->addEventAction(event_action_id)) return;
+		m_log->m_lastEventActionId = event_action_id;
+		m_log->m_eventTypes[event_action_id] = event_action.m_type;
+		m_log->m_eventMapped[event_action_id] = false;
+		m_log->m_eventBegin[event_action_id] = m_log->m_cmdTypes.size();
+		m_log->m_cmdTypes.insert(m_log->m_cmdTypes.end(), commands.types(), commands.types() + commands.size());
+		m_log->m_cmdLocations.insert(m_log->m_cmdLocations.end(),
+				commands.locations(), commands.locations() + commands.size());
+		m_log->m_eventEnd[event_action_id] = m_log->m_cmdTypes.size();
+	}
+
+	virtual void finish(int max_event_action_id) {
+		m_log->updateMaxEventActionIdFromArcs();
+	}
+
+private:
+	ActionLog* m_log;
+};
+
+// Loads a log on the threads of a pool. A sequential pass finds where the commands of
+// every event action are stored, then the commands are decoded in chunks of event
+// actions, each directly into its place in the command arrays.
+class ParallelLogLoader {
+public:
+	ParallelLogLoader(ActionLog* log, bool compact)
+		: m_log(log), m_compact(compact), m_numCommands(0) {}
+
+	// Adds the next event action, whose commands start at data, followed by size - 1
+	// more bytes that can be read. Returns false if the ids are not increasing.
+	bool addEventAction(int id, int type, int num_commands, const char* data, size_t size) {
+		if (id < 0 || (!m_events.empty() && id <= m_events.back().m_id)) return false;
+		SavedEventAction e;
+		e.m_id = id;
+		e.m_type = type;
+		e.m_numCommands = num_commands;
+		e.m_data = data;
+		e.m_size = size;
+		e.m_begin = m_numCommands;
+		m_events.push_back(e);
+		m_numCommands += num_commands;
+		return true;
+	}
+
+	bool decode(ThreadPool* pool);
+
+private:
+	struct SavedEventAction {
+		int m_id;
+		int m_type;
+		int m_numCommands;
+		const char* m_data;
+		size_t m_size;
+		// Position of the first command in the command arrays.
+		size_t m_begin;
+	};
+
+	class DecodeTask : public ThreadTask {
+	public:
+		DecodeTask(ParallelLogLoader* loader, size_t begin, size_t end)
+			: m_loader(loader), m_begin(begin), m_end(end), m_ok(false) {}
+
+		virtual void run() { m_ok = m_loader->decodeEvents(m_begin, m_end); }
+		bool ok() const { return m_ok; }
+
+	private:
+		ParallelLogLoader* m_loader;
+		size_t m_begin;
+		size_t m_end;
+		bool m_ok;
+	};
+
+	// Decodes the commands of m_events[begin] to m_events[end - 1].
+	bool decodeEvents(size_t begin, size_t end);
+
+	ActionLog* m_log;
+	bool m_compact;
+	std::vector<SavedEventAction> m_events;
+	size_t m_numCommands;
+};
+
+bool ParallelLogLoader::decode(ThreadPool* pool) {
+	int64 start_time = GetCurrentTimeMicros();
+	int num_ids = m_events.empty() ? 0 : m_events.back().m_id + 1;
+	m_log->m_eventTypes.assign(num_ids, ActionLog::NO_EVENT_ACTION);
+	m_log->m_eventMapped.assign(num_ids, false);
+	m_log->m_eventBegin.assign(num_ids, 0);
+	m_log->m_eventEnd.assign(num_ids, 0);
+	for (size_t i = 0; i < m_events.size(); ++i) {
+		const SavedEventAction& e = m_events[i];
+		m_log->m_eventTypes[e.m_id] = e.m_type;
+		m_log->m_eventBegin[e.m_id] = e.m_begin;
+		m_log->m_eventEnd[e.m_id] = e.m_begin + e.m_numCommands;
+	}
+	m_log->m_numEventActions = m_events.size();
+	if (num_ids - 1 > m_log->m_maxEventActionId) m_log->m_maxEventActionId = num_ids - 1;
+	m_log->m_lastEventActionId = num_ids - 1;
+	m_log->m_numUnusedCommands = 0;
+	m_log->m_cmdTypes.resize(m_numCommands);
+	m_log->m_cmdLocations.resize(m_numCommands);
+
+	// Several chunks per thread, so that threads that finish early can take more.
+	size_t chunk_commands = m_numCommands / (pool->numThreads() * 8) + 1;
+	if (chunk_commands < 4096) chunk_commands = 4096;
+	std::vector<DecodeTask*> tasks;
+	size_t begin = 0;
+	while (begin < m_events.size()) {
+		size_t end = begin;
+		size_t num_commands = 0;
+		while (end < m_events.size() && num_commands < chunk_commands) {
+			num_commands += m_events[end].m_numCommands;
+			++end;
+		}
+		tasks.push_back(new DecodeTask(this, begin, end));
+		pool->add(tasks.back());
+		begin = end;
+	}
+	pool->wait();
+	bool result = true;
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		result &= tasks[i]->ok();
+		delete tasks[i];
+	}
+	printf("ActionLog: Decoded %d event actions in %d chunks on %d threads for %lld ms\n",
+			static_cast<int>(m_events.size()), static_cast<int>(tasks.size()), pool->numThreads(),
+			(GetCurrentTimeMicros() - start_time) / 1000);
+	return result;
+}
+
+bool ParallelLogLoader::decodeEvents(size_t begin, size_t end) {
+	unsigned char* types = m_log->m_cmdTypes.data();
+	int* locations = m_log->m_cmdLocations.data();
+	if (!m_compact) {
+		for (size_t i = begin; i < end; ++i) {
+			const SavedEventAction& e = m_events[i];
+			const char* p = e.m_data;
+			for (int j = 0; j < e.m_numCommands; ++j) {
+				ActionLog::Command c;
+				memcpy(&c, p + j * sizeof(ActionLog::Command), sizeof(ActionLog::Command));
+				types[e.m_begin + j] = c.m_cmdType;
+				locations[e.m_begin + j] = c.m_location;
+			}
+		}
+		return true;
+	}
+	std::vector<unsigned int> deltas;
+	for (size_t i = begin; i < end; ++i) {
+		const SavedEventAction& e = m_events[i];
+		size_t pos = 0;
+		deltas.resize((e.m_numCommands + 3) / 4 * 4);
+		if (!DecodeCompactCommands(reinterpret_cast<const unsigned char*>(e.m_data), e.m_size, &pos, e.m_numCommands,
+				types + e.m_begin, locations + e.m_begin, deltas.data())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ActionLog::loadCompactFromMemory(const char* data, size_t size, size_t* pos, ThreadPool* pool) {
+	if (pool == NULL || !m_eventTypes.empty() || !m_cmdTypes.empty()) {
+		CompactLogLoader loader(this);
+		return streamCompactFromMemory(data, size, pos, &loader);
+	}
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	unsigned int num_ops;
+	std::vector<Arc> arcs;
+	if (!ReadCompactArcs(bytes, size, pos, &num_ops, &arcs)) return false;
+	ParallelLogLoader loader(this, true);
+	int id = -1;
+	for (unsigned int op = 0; op < num_ops; ++op) {
+		unsigned int id_delta, type, n;
+		if (!ReadVarint(bytes, size, pos, &id_delta) ||
+				!ReadVarint(bytes, size, pos, &type) ||
+				!ReadVarint(bytes, size, pos, &n)) {
+			return false;
+		}
+		id += id_delta + 1;
+		size_t offset = *pos;
+		size_t type_bytes = (n + 1) / 2;
+		if (size - *pos < type_bytes) return false;
+		*pos += type_bytes;
+		if (!SkipStreamVByte(bytes, size, pos, n)) return false;
+		if (!loader.addEventAction(id, type, n, data + offset, size - offset)) return false;
+	}
+	m_arcs.swap(arcs);
+	if (!loader.decode(pool)) return false;
+	updateMaxEventActionIdFromArcs();
+	return true;
+}
+
+struct ColumnsLogHeader {
+	int num_ops;
+	int num_arcs;
+	int64 num_commands;
+};
+
+// The parts of a log in the column encoding, as found in memory.
+struct ColumnsLog {
+	std::vector<ActionLog::Arc> arcs;
+	// The headers of the event actions, in increasing order of the ids.
+	const char* ops;
+	int num_ops;
+	int64 num_commands;
+	const char* locations;
+	const unsigned char* types;
+};
+
+// Finds the parts of a log in the column encoding and checks that they fit in memory.
+static bool ReadColumnsLog(const char* data, size_t size, size_t* pos, ColumnsLog* log) {
+	ColumnsLogHeader hdr;
+	if (size - *pos < sizeof(hdr)) return false;
+	memcpy(&hdr, data + *pos, sizeof(hdr));
+	*pos += sizeof(hdr);
+	if (hdr.num_arcs < 0 || hdr.num_ops < 0 || hdr.num_commands < 0) return false;
+	if ((size - *pos) / sizeof(ActionLog::Arc) < static_cast<size_t>(hdr.num_arcs)) return false;
+	log->arcs.resize(hdr.num_arcs);
+	memcpy(log->arcs.data(), data + *pos, sizeof(ActionLog::Arc) * hdr.num_arcs);
+	*pos += sizeof(ActionLog::Arc) * hdr.num_arcs;
+	if ((size - *pos) / sizeof(OperationHeader) < static_cast<size_t>(hdr.num_ops)) return false;
+	log->ops = data + *pos;
+	log->num_ops = hdr.num_ops;
+	*pos += sizeof(OperationHeader) * hdr.num_ops;
+	// Every command takes a location and a type.
+	if (static_cast<size_t>(hdr.num_commands) > (size - *pos) / (sizeof(int) + 1)) return false;
+	log->num_commands = hdr.num_commands;
+	log->locations = data + *pos;
+	*pos += sizeof(int) * hdr.num_commands;
+	log->types = reinterpret_cast<const unsigned char*>(data + *pos);
+	*pos += hdr.num_commands;
+
+	int64 num_commands = 0;
+	int last_id = -1;
+	for (int i = 0; i < log->num_ops; ++i) {
+		OperationHeader ophdr;
+		memcpy(&ophdr, log->ops + i * sizeof(ophdr), sizeof(ophdr));
+		if (ophdr.id <= last_id || ophdr.num_commands < 0) return false;
+		last_id = ophdr.id;
+		num_commands += ophdr.num_commands;
+	}
+	return num_commands == log->num_commands;
+}
+
+void ActionLog::saveColumnsToFile(FILE* f) {
+	ColumnsLogHeader hdr;
+	hdr.num_ops = m_numEventActions;
+	hdr.num_arcs = m_arcs.size();
+	hdr.num_commands = 0;
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		hdr.num_commands += m_eventEnd[id] - m_eventBegin[id];
+	}
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(m_arcs.data(), sizeof(Arc), m_arcs.size(), f);
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		OperationHeader ophdr;
+		ophdr.id = id;
+		ophdr.type = static_cast<EventActionType>(m_eventTypes[id]);
+		ophdr.num_commands = m_eventEnd[id] - m_eventBegin[id];
+		fwrite(&ophdr, sizeof(ophdr), 1, f);
+	}
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		CommandSpan cmds = commands(id);
+		fwrite(cmds.locations(), sizeof(int), cmds.size(), f);
+	}
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		CommandSpan cmds = commands(id);
+		fwrite(cmds.types(), sizeof(unsigned char), cmds.size(), f);
+	}
+	fflush(f);
+	printf("Action log saved.\n");
+}
+
+bool ActionLog::loadColumnsFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!m_eventTypes.empty() || !m_cmdTypes.empty()) {
+		CompactLogLoader loader(this);
+		return streamColumnsFromMemory(data, size, pos, &loader);
+	}
+	ColumnsLog log;
+	if (!ReadColumnsLog(data, size, pos, &log)) return false;
+	m_arcs.swap(log.arcs);
+	int num_ids = 0;
+	if (log.num_ops > 0) {
+		OperationHeader ophdr;
+		memcpy(&ophdr, log.ops + (log.num_ops - 1) * sizeof(ophdr), sizeof(ophdr));
+		num_ids = ophdr.id + 1;
+	}
+	// The locations can only be used in place if they are aligned, which they are in
+	// files written by ActionLogFile. Otherwise they are copied.
+	bool in_place = reinterpret_cast<size_t>(log.locations) % sizeof(int) == 0;
+	m_eventTypes.assign(num_ids, NO_EVENT_ACTION);
+	m_eventMapped.assign(num_ids, in_place);
+	m_eventBegin.assign(num_ids, 0);
+	m_eventEnd.assign(num_ids, 0);
+	size_t begin = 0;
+	for (int i = 0; i < log.num_ops; ++i) {
+		OperationHeader ophdr;
+		memcpy(&ophdr, log.ops + i * sizeof(ophdr), sizeof(ophdr));
+		m_eventTypes[ophdr.id] = ophdr.type;
+		m_eventBegin[ophdr.id] = begin;
+		begin += ophdr.num_commands;
+		m_eventEnd[ophdr.id] = begin;
+	}
+	m_numEventActions = log.num_ops;
+	m_numUnusedCommands = 0;
+	if (num_ids - 1 > m_maxEventActionId) m_maxEventActionId = num_ids - 1;
+	if (in_place) {
+		m_mappedTypes = log.types;
+		m_mappedLocations = reinterpret_cast<const int*>(log.locations);
+		m_lastEventActionId = -1;
+	} else {
+		m_cmdTypes.assign(log.types, log.types + log.num_commands);
+		m_cmdLocations.resize(log.num_commands);
+		memcpy(m_cmdLocations.data(), log.locations, sizeof(int) * log.num_commands);
+		m_lastEventActionId = num_ids - 1;
+	}
+	updateMaxEventActionIdFromArcs();
+	return true;
+}
+
+bool ActionLog::streamColumnsFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer) {
+	ColumnsLog log;
+	if (!ReadColumnsLog(data, size, pos, &log)) return false;
+	int max_event_action_id = -1;
+	for (size_t i = 0; i < log.arcs.size(); ++i) {
+		if (log.arcs[i].m_head > max_event_action_id) max_event_action_id = log.arcs[i].m_head;
+		if (log.arcs[i].m_tail > max_event_action_id) max_event_action_id = log.arcs[i].m_tail;
+	}
+	consumer->consumeArcs(log.arcs);
+
+	bool in_place = reinterpret_cast<size_t>(log.locations) % sizeof(int) == 0;
+	std::vector<int> locations;
+	size_t begin = 0;
+	for (int i = 0; i < log.num_ops; ++i) {
+		OperationHeader ophdr;
+		memcpy(&ophdr, log.ops + i * sizeof(ophdr), sizeof(ophdr));
+		const int* event_locations;
+		if (in_place) {
+			event_locations = reinterpret_cast<const int*>(log.locations) + begin;
+		} else {
+			locations.resize(ophdr.num_commands);
+			memcpy(locations.data(), log.locations + sizeof(int) * begin, sizeof(int) * ophdr.num_commands);
+			event_locations = locations.data();
+		}
+		EventAction event_action;
+		event_action.m_type = ophdr.type;
+		event_action.m_commands = CommandSpan(log.types + begin, event_locations, ophdr.num_commands);
+		consumer->consumeEventAction(ophdr.id, event_action);
+		begin += ophdr.num_commands;
+		if (ophdr.id > max_event_action_id) max_event_action_id = ophdr.id;
+	}
+	consumer->finish(max_event_action_id);
+	return true;
+}
+
+void ActionLog::replay(ActionLogConsumer* consumer) const {
+	consumer->consumeArcs(m_arcs);
+	for (size_t id = 0; id < m_eventTypes.size(); ++id) {
+		if (m_eventTypes[id] == NO_EVENT_ACTION) continue;
+		consumer->consumeEventAction(id, event_action(id));
+	}
+	consumer->finish(m_maxEventActionId);
+}
+
+bool ActionLog::loadFromMemory(const char* data, size_t size, size_t* pos, ThreadPool* pool) {
+	size_t begin = *pos;
+	if (!skipInMemory(data, size, pos)) return false;
+	std::vector<std::pair<const char*, size_t> > logs(1, std::pair<const char*, size_t>(data + begin, *pos - begin));
+	return loadJoinedFromMemory(logs, pool);
+}
+
+bool ActionLog::loadJoinedFromMemory(const std::vector<std::pair<const char*, size_t> >& logs, ThreadPool* pool) {
+	std::vector<Arc> arcs;
+	std::vector<SavedLogReader> readers(logs.size());
+	for (size_t i = 0; i < logs.size(); ++i) {
+		if (!readers[i].open(logs[i].first, logs[i].second, &arcs)) return false;
+	}
+	m_arcs.swap(arcs);
+	if (pool != NULL && m_eventTypes.empty() && m_cmdTypes.empty()) {
+		ParallelLogLoader loader(this, false);
+		bool in_order = true;
+		for (size_t log = 0; in_order && log < readers.size(); ++log) {
+			OperationHeader ophdr;
+			const char* commands;
+			while (in_order && readers[log].next(&ophdr, &commands)) {
+				in_order = loader.addEventAction(ophdr.id, ophdr.type, ophdr.num_commands,
+						commands, sizeof(Command) * ophdr.num_commands);
+			}
+		}
+		if (in_order) {
+			if (!loader.decode(pool)) return false;
+			updateMaxEventActionIdFromArcs();
+			return true;
+		}
+		// Event actions that are not in order are merged one by one below.
+		for (size_t i = 0; i < readers.size(); ++i) {
+			readers[i].rewind();
+		}
+	}
+	for (size_t log = 0; log < readers.size(); ++log) {
+		OperationHeader ophdr;
+		const char* commands;
+		while (readers[log].next(&ophdr, &commands)) {
+			if (!addLoadedEventAction(ophdr.id, ophdr.type, commands, ophdr.num_commands)) {
+				return false;
+			}
+		}
+	}
+	updateMaxEventActionIdFromArcs();
+	return true;
+}
+
+bool ActionLog::skipInMemory(const char* data, size_t size, size_t* pos) {
+	ActionLogHeader hdr;
+	if (size - *pos < sizeof(hdr)) return false;
+	memcpy(&hdr, data + *pos, sizeof(hdr));
+	*pos += sizeof(hdr);
+	if (hdr.num_arcs < 0 || (size - *pos) / sizeof(Arc) < static_cast<size_t>(hdr.num_arcs)) return false;
+	*pos += sizeof(Arc) * hdr.num_arcs;
+	for (int i = 0; i < hdr.num_ops; ++i) {
+		OperationHeader ophdr;
+		if (size - *pos < sizeof(ophdr)) return false;
+		memcpy(&ophdr, data + *pos, sizeof(ophdr));
+		*pos += sizeof(ophdr);
+		if (ophdr.num_commands < 0 ||
+				(size - *pos) / sizeof(Command) < static_cast<size_t>(ophdr.num_commands)) {
+			return false;
+		}
+		*pos += sizeof(Command) * ophdr.num_commands;
+	}
+	return true;
+}
+
+void ActionLog::appendHeader(int num_event_actions, const std::vector<Arc>& arcs, std::vector<char>* out) {
+	ActionLogHeader hdr;
+	hdr.num_ops = num_event_actions;
+	hdr.num_arcs = arcs.size();
+	const char* p = reinterpret_cast<const char*>(&hdr);
+	out->insert(out->end(), p, p + sizeof(hdr));
+	p = reinterpret_cast<const char*>(arcs.data());
+	out->insert(out->end(), p, p + sizeof(Arc) * arcs.size());
+}
+
+void ActionLog::appendEventAction(int id, const EventAction& event_action, std::vector<char>* out) {
+	OperationHeader ophdr;
+	ophdr.id = id;
+	ophdr.type = event_action.m_type;
+	ophdr.num_commands = event_action.m_commands.size();
+	const char* p = reinterpret_cast<const char*>(&ophdr);
+	out->insert(out->end(), p, p + sizeof(ophdr));
+	size_t pos = out->size();
+	out->resize(pos + sizeof(Command) * ophdr.num_commands);
+	for (int i = 0; i < ophdr.num_commands; ++i) {
+		Command c = event_action.m_commands[i];
+		memcpy(&(*out)[pos + i * sizeof(Command)], &c, sizeof(Command));
+	}
+}
+
+bool ActionLog::addLoadedEventAction(int id, EventActionType type, const char* commands, int num_commands) {
+	if (id < 0 || num_commands < 0) return false;
+	addEventAction(id);
+	// An event action that was entered again while recording is stored once per entry,
+	// so the commands of later entries are appended.
+	moveEventActionToEnd(id);
+	m_eventTypes[id] = type;
+	for (int i = 0; i < num_commands; ++i) {
+		Command c;
+		memcpy(&c, commands + i * sizeof(Command), sizeof(Command));
+		m_cmdTypes.push_back(c.m_cmdType);
+		m_cmdLocations.push_back(c.m_location);
+	}
+	m_eventEnd[id] = m_cmdTypes.size();
+	return true;
+}
+
+void ActionLog::updateMaxEventActionIdFromArcs() {
+	for (size_t i = 0; i < m_arcs.size(); ++i) {
+		if (m_arcs[i].m_head > m_maxEventActionId) m_maxEventActionId = m_arcs[i].m_head;
+		if (m_arcs[i].m_tail > m_maxEventActionId) m_maxEventActionId = m_arcs[i].m_tail;
+	}
+	if (!isCompact()) compact();
+}
 
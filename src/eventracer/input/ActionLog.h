@@ -18,10 +18,14 @@
 #define ACTIONLOG_H_
 
 #include <stdio.h>
-#include <map>
-#include <set>
+#include <stddef.h>
+#include <utility>
 #include <vector>
 
+class ActionLogConsumer;
+class ActionLogWriter;
+class ThreadPool;
+
 class ActionLog {
 public:
 	ActionLog();
@@ -49,7 +53,8 @@ public:
 	// Adds an arcs. Doesn't check for duplicates or validity.
 	void addArc(int earlier_event_action_id, int later_event_action_id, int arcDuration);
 
-	// Enters an operator. An operation should be entered only once and ideally it should be exited.
+	// Enters an operator. Entering an operation again appends to its commands. Ideally it should be exited.
+	// A negative id is ignored and leaves no operation entered.
 	void startEventAction(int operation);
 
 	// Exits the currently opened operation. Returns false if not in an operation.
@@ -67,6 +72,11 @@ public:
 		return logCommand(EXIT_SCOPE, -1);
 	}
 
+	// Passes the event actions to a writer when they end and then drops their commands,
+	// so that the memory used for recording does not grow with the log. The arcs are
+	// passed to the writer instead of being kept. NULL stops writing.
+	void setWriter(ActionLogWriter* writer) { m_writer = writer; }
+
 	// Returns whether logs of a certain command type will be written to the log.
 	// For example, MEMORY_VALUE can only be written after a read or a write.
 	bool willLogCommand(CommandType command);
@@ -80,6 +90,45 @@ public:
 	// Loads from log from a file.
 	bool loadFromFile(FILE* f);
 
+	// Loads the log from memory starting at data[*pos] and advances *pos past the log.
+	// If a thread pool is given, the commands are decoded on its threads.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos, ThreadPool* pool = NULL);
+
+	// Saves the log in the compact encoding: the command types are packed in four bits
+	// each and the locations are stored as zigzag varints relative to the previous
+	// location of the same command type in the event action.
+	void saveCompactToFile(FILE* f);
+
+	// Loads a log in the compact encoding from memory starting at data[*pos] and advances *pos past it.
+	bool loadCompactFromMemory(const char* data, size_t size, size_t* pos, ThreadPool* pool = NULL);
+
+	// Saves the log in the column encoding: the arcs and the event actions are followed
+	// by the locations of all commands and then by their types, in the same layout as
+	// the command arrays.
+	void saveColumnsToFile(FILE* f);
+
+	// Loads a log in the column encoding from memory starting at data[*pos] and advances
+	// *pos past it. The commands are not copied, so the memory must stay valid as long as
+	// the log is used. Event actions that are changed later are copied first.
+	bool loadColumnsFromMemory(const char* data, size_t size, size_t* pos);
+
+	// Advances *pos past a log stored in memory at data[*pos] without loading it.
+	static bool skipInMemory(const char* data, size_t size, size_t* pos);
+
+	// Reads a log stored in memory at data[*pos] without loading it, passing the event
+	// actions one by one to the consumer. The event actions must be stored in increasing
+	// order of their ids.
+	static bool streamFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer);
+
+	// Same as streamFromMemory, but for a log in the compact encoding.
+	static bool streamCompactFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer);
+
+	// Same as streamFromMemory, but for a log in the column encoding.
+	static bool streamColumnsFromMemory(const char* data, size_t size, size_t* pos, ActionLogConsumer* consumer);
+
+	// Passes the loaded log to a consumer the same way as streamFromMemory.
+	void replay(ActionLogConsumer* consumer) const;
+
 	struct Command {
 		CommandType m_cmdType;
 		// Memory location for reads/writes and scope id for scopes. Should be -1 if the location is unused.
@@ -98,36 +147,175 @@ public:
 		int m_duration;
 	};
 
+	// A read-only view of the commands of an event action. The command types and the
+	// locations are stored in separate arrays, so the commands are returned by value.
+	class CommandSpan {
+	public:
+		CommandSpan() : m_types(NULL), m_locations(NULL), m_size(0) {}
+		CommandSpan(const unsigned char* types, const int* locations, size_t size)
+			: m_types(types), m_locations(locations), m_size(size) {}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		CommandType type(size_t i) const { return static_cast<CommandType>(m_types[i]); }
+		int location(size_t i) const { return m_locations[i]; }
+
+		const unsigned char* types() const { return m_types; }
+		const int* locations() const { return m_locations; }
+
+		Command operator[](size_t i) const {
+			Command c;
+			c.m_cmdType = type(i);
+			c.m_location = location(i);
+			return c;
+		}
+
+	private:
+		const unsigned char* m_types;
+		const int* m_locations;
+		size_t m_size;
+	};
+
 	struct EventAction {
 		EventAction() : m_type(UNKNOWN) {}
 
 		EventActionType m_type;
-		std::vector<Command> m_commands;
+		CommandSpan m_commands;
 	};
 
 	const std::vector<Arc>& arcs() const { return m_arcs; }
-	const EventAction& event_action(int i) const {
-		EventActionSet::const_iterator it = m_eventActions.find(i);
-		if (it == m_eventActions.end()) {
-			return m_emptyEventAction;
-		}
-		return *(it->second);
+
+	// Returns whether an event action with this id was recorded, even one without
+	// commands. event_action returns an empty UNKNOWN event action for other ids.
+	bool hasEventAction(int i) const {
+		return i >= 0 && static_cast<size_t>(i) < m_eventTypes.size() && m_eventTypes[i] != NO_EVENT_ACTION;
 	}
-	EventAction* mutable_event_action(int i) {
-		return m_eventActions[i];
+	EventAction event_action(int i) const {
+		EventAction result;
+		if (!hasEventAction(i)) return result;
+		result.m_type = static_cast<EventActionType>(m_eventTypes[i]);
+		result.m_commands = commands(i);
+		return result;
 	}
 	int maxEventActionId() const { return m_maxEventActionId; }
 
+	// Changes the location of a command. Does nothing if there is no such command.
+	void setCommandLocation(int event_action_id, int command_id, int location);
+
+	// Adds an event action recorded elsewhere, appending its commands if it exists. With
+	// a writer, it is passed to the writer. Returns false if an event action is open.
+	bool copyEventAction(int id, const EventAction& event_action);
+
+	// Removes the commands of an event action, keeping the event action. Does nothing
+	// if there is no such event action.
+	void clearEventAction(int id);
+
+	// Appends the header of a log in the encoding of saveToFile, followed by the arcs.
+	// The given number of event actions must be appended after it.
+	static void appendHeader(int num_event_actions, const std::vector<Arc>& arcs, std::vector<char>* out);
+
+	// Appends an event action in the encoding of saveToFile.
+	static void appendEventAction(int id, const EventAction& event_action, std::vector<char>* out);
+
+	// Loads several logs in the encoding of saveToFile as one log with all their arcs
+	// followed by all their event actions. The commands are decoded from where each log
+	// is, so the logs do not need to be next to each other in memory.
+	bool loadJoinedFromMemory(const std::vector<std::pair<const char*, size_t> >& logs, ThreadPool* pool = NULL);
+
+	// Same as streamFromMemory, but for logs joined as in loadJoinedFromMemory.
+	static bool streamJoinedFromMemory(const std::vector<std::pair<const char*, size_t> >& logs,
+			ActionLogConsumer* consumer);
+
 private:
-	typedef std::map<int, EventAction*> EventActionSet;
-	EventAction m_emptyEventAction;
-	EventActionSet m_eventActions;
+	friend class CompactLogLoader;
+	friend class ParallelLogLoader;
+
+	// Event type of ids for which there is no event action.
+	enum { NO_EVENT_ACTION = 0xff };
+
+	CommandSpan commands(size_t id) const {
+		if (m_eventMapped[id]) {
+			return CommandSpan(m_mappedTypes + m_eventBegin[id], m_mappedLocations + m_eventBegin[id],
+					m_eventEnd[id] - m_eventBegin[id]);
+		}
+		return CommandSpan(m_cmdTypes.data() + m_eventBegin[id], m_cmdLocations.data() + m_eventBegin[id],
+				m_eventEnd[id] - m_eventBegin[id]);
+	}
+
+	// Creates an event action if it does not exist yet. Returns false for a negative id.
+	bool addEventAction(int id);
+	// Moves the commands of an event action to the end of the command arrays, copying
+	// them from the mapped arrays if they are there.
+	void moveEventActionToEnd(int id);
+	// Removes the unused commands and orders the commands in the command arrays by
+	// event action id.
+	void compact();
+	bool isCompact() const;
+
+	bool addLoadedEventAction(int id, EventActionType type, const char* commands, int num_commands);
+	void updateMaxEventActionIdFromArcs();
+
+	// Adds a read or a write to the commands of the current event action seen so far.
+	// Returns false if it was already there.
+	bool addCurrentEventCommand(CommandType command, int location);
+	void clearCurrentEventCommands();
+	void resizeCurrentEventCommands(size_t capacity);
+
+	// Commands of all event actions. The commands of each event action are stored
+	// contiguously and normally ordered by event action id.
+	std::vector<unsigned char> m_cmdTypes;
+	std::vector<int> m_cmdLocations;
+	// Number of commands in m_cmdTypes not referenced by any event action.
+	size_t m_numUnusedCommands;
+	// Commands of the event actions loaded by loadColumnsFromMemory, in the memory they
+	// were loaded from. The command arrays are only used for the other event actions.
+	const unsigned char* m_mappedTypes;
+	const int* m_mappedLocations;
+
+	// Per event action id: its type, whether its commands are in the mapped arrays and
+	// the range of its commands.
+	std::vector<unsigned char> m_eventTypes;
+	std::vector<bool> m_eventMapped;
+	std::vector<size_t> m_eventBegin;
+	std::vector<size_t> m_eventEnd;
+	int m_numEventActions;
+
 	int m_maxEventActionId;
 	std::vector<Arc> m_arcs;
 
 	// Fields to help construction.
 	int m_currentEventActionId;
-	std::set<Command> m_cmdsInCurrentEvent;
+	// The event action whose commands are at the end of the command arrays.
+	int m_lastEventActionId;
+	// The reads and writes of the current event action in an open addressing table.
+	// A slot is used only if its generation is the current one, so the table is
+	// cleared for the next event action by incrementing the generation.
+	struct CommandSlot {
+		unsigned int m_generation;
+		int m_location;
+		int m_cmdType;
+	};
+	std::vector<CommandSlot> m_cmdsInCurrentEvent;
+	unsigned int m_cmdsGeneration;
+	size_t m_numCmdsInCurrentEvent;
+	ActionLogWriter* m_writer;
+};
+
+// Receives the parts of an action log in the order in which they are stored.
+class ActionLogConsumer {
+public:
+	virtual ~ActionLogConsumer() {}
+
+	// Called once with all the arcs, before any event action.
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs) {}
+
+	// Called for every event action in increasing order of the ids. The commands are
+	// valid only during the call.
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) = 0;
+
+	// Called after the last event action.
+	virtual void finish(int max_event_action_id) {}
 };
 
 #endif /* ACTIONLOG_H_ */
@@ -0,0 +1,127 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLogCopier.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "StringSet.h"
+#include "stringprintf.h"
+
+namespace {
+
+// Finds the JavaScript index in scopes of the form "Call (#<js>) ..." or
+// "Exec (fn=<id> #<js>) ...". Returns false if the scope is not of this form.
+bool FindJsIndex(const char* scope, size_t* begin, size_t* end) {
+	if (strncmp(scope, "Call (", 6) != 0 && strncmp(scope, "Exec (", 6) != 0) return false;
+	const char* hash = strchr(scope + 6, '#');
+	const char* paren = strchr(scope + 6, ')');
+	if (hash == NULL || paren == NULL || hash > paren) return false;
+	const char* p = hash + 1;
+	while (*p >= '0' && *p <= '9') ++p;
+	if (p == hash + 1 || p != paren) return false;
+	*begin = hash + 1 - scope;
+	*end = p - scope;
+	return true;
+}
+
+}  // namespace
+
+ActionLogCopier::ActionLogCopier(ActionLog* actions, StringSet* vars, StringSet* scopes, StringSet* js,
+		StringSet* mem_values)
+	: m_actions(actions), m_eventActionIdOffset(0) {
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		m_out[i] = NULL;
+		m_in[i] = NULL;
+	}
+	m_out[ActionLogFile::VARS] = vars;
+	m_out[ActionLogFile::SCOPES] = scopes;
+	m_out[ActionLogFile::JS] = js;
+	m_out[ActionLogFile::MEM_VALUES] = mem_values;
+}
+
+void ActionLogCopier::setInput(const StringSet* vars, const StringSet* scopes, const StringSet* js,
+		const StringSet* mem_values, int event_action_id_offset) {
+	m_in[ActionLogFile::VARS] = vars;
+	m_in[ActionLogFile::SCOPES] = scopes;
+	m_in[ActionLogFile::JS] = js;
+	m_in[ActionLogFile::MEM_VALUES] = mem_values;
+	m_eventActionIdOffset = event_action_id_offset;
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		m_copied[i].assign(m_in[i] == NULL ? 0 : m_in[i]->dataSize(), -1);
+	}
+}
+
+int ActionLogCopier::copyString(ActionLogFile::Section section, int index) {
+	std::vector<int>& copied = m_copied[section];
+	if (m_out[section] == NULL || index < 0 || index >= static_cast<int>(copied.size())) return -1;
+	if (copied[index] == -1) {
+		const char* s = m_in[section]->getString(index);
+		if (section == ActionLogFile::SCOPES) {
+			copied[index] = m_out[section]->addString(rewriteScope(s).c_str());
+		} else {
+			copied[index] = m_out[section]->addString(s);
+		}
+	}
+	return copied[index];
+}
+
+std::string ActionLogCopier::rewriteScope(const char* scope) {
+	size_t begin, end;
+	if (!FindJsIndex(scope, &begin, &end)) return scope;
+	int js = copyString(ActionLogFile::JS, atoi(scope + begin));
+	if (js == -1) return scope;
+	std::string result(scope, begin);
+	StringAppendF(&result, "%d", js);
+	result.append(scope + end);
+	return result;
+}
+
+void ActionLogCopier::copyArc(const ActionLog::Arc& arc) {
+	m_actions->addArc(arc.m_tail + m_eventActionIdOffset, arc.m_head + m_eventActionIdOffset, arc.m_duration);
+}
+
+void ActionLogCopier::copyEventAction(int id, const ActionLog::EventAction& event_action) {
+	const ActionLog::CommandSpan& cmds = event_action.m_commands;
+	m_cmdTypes.assign(cmds.types(), cmds.types() + cmds.size());
+	m_cmdLocations.resize(cmds.size());
+	for (size_t i = 0; i < cmds.size(); ++i) {
+		int location = cmds.location(i);
+		switch (cmds.type(i)) {
+		case ActionLog::ENTER_SCOPE:
+			location = copyString(ActionLogFile::SCOPES, location);
+			break;
+		case ActionLog::READ_MEMORY:
+		case ActionLog::WRITE_MEMORY:
+			location = copyString(ActionLogFile::VARS, location);
+			break;
+		case ActionLog::MEMORY_VALUE:
+			location = copyString(ActionLogFile::MEM_VALUES, location);
+			break;
+		case ActionLog::TRIGGER_ARC:
+			if (location >= 0) location += m_eventActionIdOffset;
+			break;
+		case ActionLog::EXIT_SCOPE:
+			break;
+		}
+		m_cmdLocations[i] = location;
+	}
+	ActionLog::EventAction copy;
+	copy.m_type = event_action.m_type;
+	copy.m_commands = ActionLog::CommandSpan(m_cmdTypes.data(), m_cmdLocations.data(), cmds.size());
+	m_actions->copyEventAction(id + m_eventActionIdOffset, copy);
+}
@@ -0,0 +1,72 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ACTIONLOGCOPIER_H_
+#define ACTIONLOGCOPIER_H_
+
+#include <string>
+#include <vector>
+
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+
+class StringSet;
+
+// Copies arcs and event actions from input logs to an output log. The strings the
+// copied commands use are added to the string sets of the output, so the output only
+// has the strings it needs, and the event action ids can be shifted. Used to split a
+// log into parts and to merge logs.
+//
+// Scopes of JavaScript code refer to the code by its index in the js strings, for
+// example "Call (#12) line 3-5". These scopes are rewritten with the index of the code
+// in the output.
+class ActionLogCopier {
+public:
+	// js and mem_values can be NULL if the output has no such strings.
+	ActionLogCopier(ActionLog* actions, StringSet* vars, StringSet* scopes, StringSet* js, StringSet* mem_values);
+
+	// Sets the log to copy from. The ids of the copied event actions, arcs and trigger
+	// commands are increased by event_action_id_offset. js and mem_values can be NULL.
+	void setInput(const StringSet* vars, const StringSet* scopes, const StringSet* js, const StringSet* mem_values,
+			int event_action_id_offset);
+
+	void copyArc(const ActionLog::Arc& arc);
+	void copyEventAction(int id, const ActionLog::EventAction& event_action);
+
+private:
+	// Returns the index in the output of a string from the input, or -1 if the output
+	// has no strings of that section.
+	int copyString(ActionLogFile::Section section, int index);
+	std::string rewriteScope(const char* scope);
+
+	ActionLog* m_actions;
+	StringSet* m_out[ActionLogFile::NUM_SECTIONS];
+	const StringSet* m_in[ActionLogFile::NUM_SECTIONS];
+	int m_eventActionIdOffset;
+	// Per section, the index in the output of the strings of the input copied so far,
+	// at their index in the input, or -1.
+	std::vector<int> m_copied[ActionLogFile::NUM_SECTIONS];
+
+	// The commands of the event action being copied.
+	std::vector<unsigned char> m_cmdTypes;
+	std::vector<int> m_cmdLocations;
+
+	// Deleted.
+	ActionLogCopier(const ActionLogCopier&);
+	ActionLogCopier& operator=(const ActionLogCopier&);
+};
+
+#endif /* ACTIONLOGCOPIER_H_ */
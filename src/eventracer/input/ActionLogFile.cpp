@@ -0,0 +1,337 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLogFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "ActionLog.h"
+#include "StringSet.h"
+#include "thread_pool.h"
+
+namespace {
+
+const char* const kSectionNames[ActionLogFile::NUM_SECTIONS] = {
+		"vars", "scopes", "actions", "js", "values" };
+
+// Loads one string section and measures how long it takes.
+class LoadStringsTask : public ThreadTask {
+public:
+	LoadStringsTask(const ActionLogFile* file, ActionLogFile::Section section, StringSet* strings)
+		: m_file(file), m_section(section), m_strings(strings), m_ok(false), m_timeMs(0) {}
+
+	virtual void run() {
+		int64 start_time = GetCurrentTimeMicros();
+		m_ok = m_file->loadStrings(m_section, m_strings);
+		m_timeMs = (GetCurrentTimeMicros() - start_time) / 1000;
+	}
+
+	ActionLogFile::Section section() const { return m_section; }
+	bool ok() const { return m_ok; }
+	int64 timeMs() const { return m_timeMs; }
+
+private:
+	const ActionLogFile* m_file;
+	ActionLogFile::Section m_section;
+	StringSet* m_strings;
+	bool m_ok;
+	int64 m_timeMs;
+};
+
+struct SectionEntry {
+	int section;
+	int encoding;
+	int64 offset;
+	int64 size;
+};
+
+// Sections in version 2 files start at offsets aligned to this.
+const int kSectionAlignment = 8;
+
+// Returns the size of a string set saved at data[pos] or 0 if it is invalid.
+size_t stringSetSize(const char* data, size_t size, size_t pos) {
+	int n;
+	if (size - pos < 2 * sizeof(int)) return 0;
+	memcpy(&n, data + pos, sizeof(int));
+	if (n < 0 || size - pos - 2 * sizeof(int) < static_cast<size_t>(n)) return 0;
+	return 2 * sizeof(int) + n;
+}
+
+}  // namespace
+
+const char ActionLogFile::kMagic[8] = { 'E', 'R', 'A', 'C', 'T', 'L', 'O', 'G' };
+
+ActionLogFile::ActionLogFile() : m_version(0) {
+	for (int i = 0; i < NUM_SECTIONS; ++i) {
+		m_sectionOffset[i] = 0;
+		m_sectionSize[i] = 0;
+		m_sectionEncoding[i] = RAW;
+	}
+}
+
+bool ActionLogFile::open(const char* filename) {
+	if (!m_file.open(filename)) return false;
+	if (m_file.size() >= sizeof(kMagic) && memcmp(m_file.data(), kMagic, sizeof(kMagic)) == 0) {
+		FileHeader hdr;
+		if (m_file.size() >= sizeof(hdr)) {
+			memcpy(&hdr, m_file.data(), sizeof(hdr));
+			if (hdr.version == 3) return readJournal();
+		}
+		return readSectionTable();
+	}
+	return findVersion1Sections();
+}
+
+bool ActionLogFile::readSectionTable() {
+	const char* data = m_file.data();
+	size_t size = m_file.size();
+	FileHeader hdr;
+	if (size < sizeof(hdr)) return false;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.version != 2 || hdr.num_sections < 0 ||
+			(size - sizeof(hdr)) / sizeof(SectionEntry) < static_cast<size_t>(hdr.num_sections)) {
+		fprintf(stderr, "Unsupported ER_actionlog version %d\n", hdr.version);
+		return false;
+	}
+	m_version = hdr.version;
+	for (int i = 0; i < hdr.num_sections; ++i) {
+		SectionEntry entry;
+		memcpy(&entry, data + sizeof(hdr) + i * sizeof(entry), sizeof(entry));
+		if (entry.offset < 0 || entry.size < 0 || entry.offset > static_cast<int64>(size) ||
+				static_cast<int64>(size) - entry.offset < entry.size) {
+			return false;
+		}
+		// Ignore sections added by newer versions.
+		if (entry.section < 0 || entry.section >= NUM_SECTIONS) continue;
+		m_sectionOffset[entry.section] = entry.offset;
+		m_sectionSize[entry.section] = entry.size;
+		m_sectionEncoding[entry.section] = entry.encoding;
+		bool valid_encoding = entry.encoding == RAW ||
+				(entry.section == ACTIONS && (entry.encoding == COMPACT || entry.encoding == COLUMNS)) ||
+				(entry.section != ACTIONS && entry.encoding == INDEXED);
+		if (!valid_encoding) {
+			fprintf(stderr, "Unsupported encoding %d of section %d\n", entry.encoding, entry.section);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ActionLogFile::readJournal() {
+	const char* data = m_file.data();
+	int64 size;
+	if (m_file.size() < sizeof(FileHeader) + sizeof(size)) return false;
+	memcpy(&size, data + sizeof(FileHeader), sizeof(size));
+	// Anything after the written size may be incomplete.
+	if (size < 0 || size > static_cast<int64>(m_file.size())) size = m_file.size();
+	m_version = 3;
+	int64 pos = sizeof(FileHeader) + sizeof(size);
+	while (size - pos >= static_cast<int64>(sizeof(JournalBlock))) {
+		JournalBlock block;
+		memcpy(&block, data + pos, sizeof(block));
+		pos += sizeof(block);
+		if (block.size < 0 || size - pos < block.size) break;
+		if (block.section >= 0 && block.section < NUM_SECTIONS && block.encoding == RAW) {
+			m_journalBlocks[block.section].push_back(std::pair<int64, int64>(pos, block.size));
+			m_sectionSize[block.section] += sizeof(block) + block.size;
+		}
+		pos += block.size;
+	}
+	return hasSection(ACTIONS);
+}
+
+const char* ActionLogFile::sectionData(Section section, std::vector<char>* buffer, size_t* size) const {
+	if (m_version != 3) {
+		*size = m_sectionSize[section];
+		return m_file.data() + m_sectionOffset[section];
+	}
+	// The blocks contain string data, which gets the size before and after it as in
+	// StringSet::saveToFile.
+	const std::vector<std::pair<int64, int64> >& blocks = m_journalBlocks[section];
+	int n = 0;
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		n += blocks[i].second;
+	}
+	buffer->resize(sizeof(int));
+	memcpy(buffer->data(), &n, sizeof(int));
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		const char* block = m_file.data() + blocks[i].first;
+		buffer->insert(buffer->end(), block, block + blocks[i].second);
+	}
+	int capacity = 0;
+	buffer->insert(buffer->end(), reinterpret_cast<const char*>(&capacity),
+			reinterpret_cast<const char*>(&capacity) + sizeof(int));
+	*size = buffer->size();
+	return buffer->data();
+}
+
+std::vector<std::pair<const char*, size_t> > ActionLogFile::actionBlocks() const {
+	std::vector<std::pair<const char*, size_t> > logs;
+	const std::vector<std::pair<int64, int64> >& blocks = m_journalBlocks[ACTIONS];
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		logs.push_back(std::pair<const char*, size_t>(m_file.data() + blocks[i].first, blocks[i].second));
+	}
+	return logs;
+}
+
+bool ActionLogFile::findVersion1Sections() {
+	const char* data = m_file.data();
+	size_t size = m_file.size();
+	m_version = 1;
+	size_t pos = 0;
+	for (int section = VARS; section < NUM_SECTIONS && pos < size; ++section) {
+		size_t section_size;
+		if (section == ACTIONS) {
+			// Skip the actions without decoding them.
+			size_t end = pos;
+			if (!ActionLog::skipInMemory(data, size, &end)) return false;
+			section_size = end - pos;
+		} else {
+			section_size = stringSetSize(data, size, pos);
+			if (section_size == 0) break;
+		}
+		m_sectionOffset[section] = pos;
+		m_sectionSize[section] = section_size;
+		pos += section_size;
+	}
+	return hasSection(ACTIONS);
+}
+
+bool ActionLogFile::loadStrings(Section section, StringSet* strings) const {
+	if (!hasSection(section)) return false;
+	std::vector<char> buffer;
+	size_t size;
+	const char* data = sectionData(section, &buffer, &size);
+	size_t pos = 0;
+	if (m_sectionEncoding[section] == INDEXED) {
+		return strings->loadIndexedFromMemory(data, size, &pos);
+	}
+	return strings->loadFromMemory(data, size, &pos);
+}
+
+bool ActionLogFile::loadActions(ActionLog* actions, ThreadPool* pool) const {
+	if (!hasSection(ACTIONS)) return false;
+	if (m_version == 3) return actions->loadJoinedFromMemory(actionBlocks(), pool);
+	size_t size = m_sectionSize[ACTIONS];
+	const char* data = m_file.data() + m_sectionOffset[ACTIONS];
+	size_t pos = 0;
+	if (m_sectionEncoding[ACTIONS] == COMPACT) {
+		return actions->loadCompactFromMemory(data, size, &pos, pool);
+	}
+	if (m_sectionEncoding[ACTIONS] == COLUMNS) {
+		return actions->loadColumnsFromMemory(data, size, &pos);
+	}
+	return actions->loadFromMemory(data, size, &pos, pool);
+}
+
+bool ActionLogFile::streamActions(ActionLogConsumer* consumer) const {
+	if (!hasSection(ACTIONS)) return false;
+	if (m_version == 3) return ActionLog::streamJoinedFromMemory(actionBlocks(), consumer);
+	size_t size = m_sectionSize[ACTIONS];
+	const char* data = m_file.data() + m_sectionOffset[ACTIONS];
+	size_t pos = 0;
+	if (m_sectionEncoding[ACTIONS] == COMPACT) {
+		return ActionLog::streamCompactFromMemory(data, size, &pos, consumer);
+	}
+	if (m_sectionEncoding[ACTIONS] == COLUMNS) {
+		return ActionLog::streamColumnsFromMemory(data, size, &pos, consumer);
+	}
+	return ActionLog::streamFromMemory(data, size, &pos, consumer);
+}
+
+bool ActionLogFile::load(StringSet* vars, StringSet* scopes, ActionLog* actions,
+		StringSet* js, StringSet* mem_values, ThreadPool* pool) const {
+	int64 start_time = GetCurrentTimeMicros();
+	StringSet* strings[NUM_SECTIONS] = { vars, scopes, NULL, js, mem_values };
+	std::vector<LoadStringsTask*> tasks;
+	for (int section = VARS; section < NUM_SECTIONS; ++section) {
+		if (strings[section] == NULL) continue;
+		if ((section == JS || section == MEM_VALUES) && !hasSection(static_cast<Section>(section))) continue;
+		tasks.push_back(new LoadStringsTask(this, static_cast<Section>(section), strings[section]));
+		if (pool != NULL) {
+			pool->add(tasks.back());
+		} else {
+			tasks.back()->run();
+		}
+	}
+	// The actions are loaded on this thread while the pool loads the strings.
+	bool result = true;
+	int64 actions_time = GetCurrentTimeMicros();
+	if (actions) result &= loadActions(actions, pool);
+	actions_time = GetCurrentTimeMicros() - actions_time;
+	if (pool != NULL) pool->wait();
+
+	printf("ActionLogFile: Loaded");
+	for (size_t i = 0; i < tasks.size(); ++i) {
+		result &= tasks[i]->ok();
+		printf(" %s %lld ms,", kSectionNames[tasks[i]->section()], tasks[i]->timeMs());
+		delete tasks[i];
+	}
+	if (actions) printf(" %s %lld ms,", kSectionNames[ACTIONS], actions_time / 1000);
+	printf(" total %lld ms on %d threads\n", (GetCurrentTimeMicros() - start_time) / 1000,
+			pool != NULL ? pool->numThreads() : 1);
+	return result;
+}
+
+bool ActionLogFile::write(const char* filename, StringSet* vars, StringSet* scopes, ActionLog* actions,
+		StringSet* js, StringSet* mem_values, Encoding actions_encoding) {
+	FILE* f = fopen(filename, "wb");
+	if (!f) return false;
+	StringSet* strings[NUM_SECTIONS] = { vars, scopes, NULL, js, mem_values };
+
+	FileHeader hdr;
+	memcpy(hdr.magic, kMagic, sizeof(kMagic));
+	hdr.version = 2;
+	hdr.num_sections = 0;
+	for (int section = 0; section < NUM_SECTIONS; ++section) {
+		if (section == ACTIONS || strings[section] != NULL) ++hdr.num_sections;
+	}
+	std::vector<SectionEntry> entries(hdr.num_sections);
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(entries.data(), sizeof(SectionEntry), entries.size(), f);
+
+	int entry_id = 0;
+	for (int section = 0; section < NUM_SECTIONS; ++section) {
+		if (section != ACTIONS && strings[section] == NULL) continue;
+		static const char padding[kSectionAlignment] = { 0 };
+		long pos = ftell(f);
+		if (pos % kSectionAlignment != 0) {
+			fwrite(padding, 1, kSectionAlignment - pos % kSectionAlignment, f);
+		}
+		SectionEntry& entry = entries[entry_id++];
+		entry.section = section;
+		entry.encoding = section == ACTIONS ? actions_encoding : INDEXED;
+		entry.offset = ftell(f);
+		if (section == ACTIONS && actions_encoding == COMPACT) {
+			actions->saveCompactToFile(f);
+		} else if (section == ACTIONS && actions_encoding == COLUMNS) {
+			actions->saveColumnsToFile(f);
+		} else if (section == ACTIONS) {
+			actions->saveToFile(f);
+		} else {
+			strings[section]->saveIndexedToFile(f);
+		}
+		entry.size = ftell(f) - entry.offset;
+	}
+
+	fseek(f, sizeof(hdr), SEEK_SET);
+	fwrite(entries.data(), sizeof(SectionEntry), entries.size(), f);
+	bool result = !ferror(f);
+	result &= fclose(f) == 0;
+	return result;
+}
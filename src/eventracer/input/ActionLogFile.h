@@ -0,0 +1,136 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ACTIONLOGFILE_H_
+#define ACTIONLOGFILE_H_
+
+#include <stddef.h>
+#include <utility>
+#include <vector>
+#include "base.h"
+#include "file.h"
+
+class ActionLog;
+class ActionLogConsumer;
+class StringSet;
+class ThreadPool;
+
+// An ER_actionlog file mapped in memory.
+//
+// Version 1 files consist of the sections vars, scopes, actions, js and mem values
+// written back to back, where the last two are optional. Version 2 files start with
+// a header and a table with the offset and size of every section, followed by the
+// sections in one of the encodings below. The column encoding of the actions can be
+// used in place, without copying the commands. Version 3 files are written while
+// the log is recorded, see ActionLogWriter. They consist of blocks, each with a part
+// of a section. The parts of the string sections are joined when they are loaded,
+// the actions are decoded block by block. All versions can be read and the sections
+// can be loaded independently of each other and in any order.
+class ActionLogFile {
+public:
+	enum Section {
+		VARS = 0,
+		SCOPES,
+		ACTIONS,
+		JS,
+		MEM_VALUES,
+		NUM_SECTIONS
+	};
+
+	// Encodings of the sections.
+	enum Encoding {
+		RAW = 0,      // As saved by ActionLog::saveToFile or StringSet::saveToFile.
+		COMPACT = 1,  // Actions only, as saved by ActionLog::saveCompactToFile.
+		INDEXED = 2,  // String sets only, as saved by StringSet::saveIndexedToFile.
+		COLUMNS = 3   // Actions only, as saved by ActionLog::saveColumnsToFile.
+	};
+
+	ActionLogFile();
+
+	// Maps the file in memory and finds its sections. Returns false if the file cannot
+	// be opened or is not a valid ER_actionlog.
+	bool open(const char* filename);
+
+	// The version of the file format.
+	int version() const { return m_version; }
+
+	bool hasSection(Section section) const { return m_sectionSize[section] != 0; }
+
+	// Load a single section. Return false if the section is missing or invalid.
+	bool loadStrings(Section section, StringSet* strings) const;
+	// If a thread pool is given, the commands are decoded on its threads. Actions in the
+	// column encoding are used in place, so this file must stay open while they are used.
+	bool loadActions(ActionLog* actions, ThreadPool* pool = NULL) const;
+
+	// Passes the event actions to a consumer without loading them.
+	bool streamActions(ActionLogConsumer* consumer) const;
+
+	// Loads all sections. The js and mem_values sections are only loaded if present
+	// in the file. Any of the arguments can be NULL to skip loading a section.
+	// If a thread pool is given, the sections are loaded concurrently on its threads.
+	// Prints the time each section takes.
+	bool load(StringSet* vars, StringSet* scopes, ActionLog* actions,
+			StringSet* js, StringSet* mem_values, ThreadPool* pool = NULL) const;
+
+	// The size of the file in bytes.
+	size_t size() const { return m_file.size(); }
+
+	// Writes a version 2 file. js and mem_values can be NULL. The string sets are
+	// written with their hash tables.
+	static bool write(const char* filename, StringSet* vars, StringSet* scopes, ActionLog* actions,
+			StringSet* js, StringSet* mem_values, Encoding actions_encoding);
+
+private:
+	friend class ActionLogWriter;
+
+	struct FileHeader {
+		char magic[8];
+		int version;
+		int num_sections;
+	};
+
+	// In version 3 files, the file header is followed by the size of the part of the
+	// file that was completely written and then by blocks, each starting with this.
+	struct JournalBlock {
+		int section;
+		int encoding;
+		int64 size;
+	};
+
+	static const char kMagic[8];
+
+	bool readSectionTable();
+	bool readJournal();
+	bool findVersion1Sections();
+
+	// Returns the data of a string section in its encoding. The parts of sections in
+	// version 3 files are joined in buffer.
+	const char* sectionData(Section section, std::vector<char>* buffer, size_t* size) const;
+
+	// Returns the blocks of the actions in a version 3 file, each a log in the RAW
+	// encoding. They are decoded where they are mapped, without joining them.
+	std::vector<std::pair<const char*, size_t> > actionBlocks() const;
+
+	MappedFile m_file;
+	int m_version;
+	int64 m_sectionOffset[NUM_SECTIONS];
+	int64 m_sectionSize[NUM_SECTIONS];
+	int m_sectionEncoding[NUM_SECTIONS];
+	// The offsets and sizes of the blocks of each section in a version 3 file.
+	std::vector<std::pair<int64, int64> > m_journalBlocks[NUM_SECTIONS];
+};
+
+#endif /* ACTIONLOGFILE_H_ */
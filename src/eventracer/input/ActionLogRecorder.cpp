@@ -0,0 +1,166 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLogRecorder.h"
+
+#include <algorithm>
+
+namespace {
+
+// An event action in the buffer of a thread.
+struct BufferedEventAction {
+	int m_id;
+	int m_thread;
+	size_t m_index;
+
+	bool operator<(const BufferedEventAction& o) const { return m_id < o.m_id; }
+};
+
+}  // namespace
+
+void ActionLogRecorder::Buffer::swap(Buffer* other) {
+	m_eventActions.swap(other->m_eventActions);
+	m_cmdTypes.swap(other->m_cmdTypes);
+	m_cmdLocations.swap(other->m_cmdLocations);
+	m_arcs.swap(other->m_arcs);
+}
+
+ActionLogRecorder::ActionLogRecorder(StringSet* vars, StringSet* scopes, StringSet* js, StringSet* mem_values) {
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		m_strings[i] = NULL;
+	}
+	m_strings[ActionLogFile::VARS] = vars;
+	m_strings[ActionLogFile::SCOPES] = scopes;
+	m_strings[ActionLogFile::JS] = js;
+	m_strings[ActionLogFile::MEM_VALUES] = mem_values;
+}
+
+ActionLogRecorder::~ActionLogRecorder() {
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		delete m_threads[i];
+	}
+}
+
+ActionLogRecorder::Thread* ActionLogRecorder::newThread() {
+	Thread* thread = new Thread(this);
+	lock_guard<mutex> lock(m_threadsMutex);
+	m_threads.push_back(thread);
+	return thread;
+}
+
+void ActionLogRecorder::flush(ActionLog* log) {
+	std::vector<Buffer> buffers;
+	{
+		lock_guard<mutex> lock(m_threadsMutex);
+		buffers.resize(m_threads.size());
+		for (size_t i = 0; i < m_threads.size(); ++i) {
+			lock_guard<mutex> buffer_lock(m_threads[i]->m_bufferMutex);
+			buffers[i].swap(&m_threads[i]->m_buffer);
+		}
+	}
+
+	std::vector<BufferedEventAction> order;
+	for (size_t i = 0; i < buffers.size(); ++i) {
+		for (size_t j = 0; j < buffers[i].m_eventActions.size(); ++j) {
+			BufferedEventAction e;
+			e.m_id = buffers[i].m_eventActions[j].m_id;
+			e.m_thread = i;
+			e.m_index = j;
+			order.push_back(e);
+		}
+	}
+	std::stable_sort(order.begin(), order.end());
+
+	// A writer of the log reads the string sets.
+	lock_guard<mutex> lock(m_stringsMutex);
+	for (size_t i = 0; i < buffers.size(); ++i) {
+		const std::vector<ActionLog::Arc>& arcs = buffers[i].m_arcs;
+		for (size_t j = 0; j < arcs.size(); ++j) {
+			log->addArc(arcs[j].m_tail, arcs[j].m_head, arcs[j].m_duration);
+		}
+	}
+	for (size_t i = 0; i < order.size(); ++i) {
+		const Buffer& buffer = buffers[order[i].m_thread];
+		const Buffer::Entry& entry = buffer.m_eventActions[order[i].m_index];
+		ActionLog::EventAction event_action;
+		event_action.m_type = entry.m_type;
+		event_action.m_commands = ActionLog::CommandSpan(
+				buffer.m_cmdTypes.data() + entry.m_begin,
+				buffer.m_cmdLocations.data() + entry.m_begin,
+				entry.m_end - entry.m_begin);
+		log->copyEventAction(entry.m_id, event_action);
+	}
+}
+
+ActionLogRecorder::Thread::Thread(ActionLogRecorder* recorder)
+	: m_recorder(recorder), m_currentEventActionId(-1) {
+}
+
+void ActionLogRecorder::Thread::addArc(int earlier_event_action_id, int later_event_action_id, int arc_duration) {
+	ActionLog::Arc arc;
+	arc.m_tail = earlier_event_action_id;
+	arc.m_head = later_event_action_id;
+	arc.m_duration = arc_duration;
+	lock_guard<mutex> lock(m_bufferMutex);
+	m_buffer.m_arcs.push_back(arc);
+}
+
+void ActionLogRecorder::Thread::startEventAction(int event_action_id) {
+	if (m_currentEventActionId != -1) endEventAction();
+	m_currentEventActionId = event_action_id;
+	m_log.startEventAction(0);
+	// Id 0 keeps the type of the previous event action.
+	m_log.setEventActionType(ActionLog::UNKNOWN);
+}
+
+bool ActionLogRecorder::Thread::endEventAction() {
+	if (m_currentEventActionId == -1) return false;
+	m_log.endEventAction();
+	ActionLog::EventAction event_action = m_log.event_action(0);
+	const ActionLog::CommandSpan& cmds = event_action.m_commands;
+	{
+		lock_guard<mutex> lock(m_bufferMutex);
+		Buffer::Entry entry;
+		entry.m_id = m_currentEventActionId;
+		entry.m_type = event_action.m_type;
+		entry.m_begin = m_buffer.m_cmdTypes.size();
+		m_buffer.m_cmdTypes.insert(m_buffer.m_cmdTypes.end(), cmds.types(), cmds.types() + cmds.size());
+		m_buffer.m_cmdLocations.insert(m_buffer.m_cmdLocations.end(), cmds.locations(), cmds.locations() + cmds.size());
+		entry.m_end = m_buffer.m_cmdTypes.size();
+		m_buffer.m_eventActions.push_back(entry);
+	}
+	m_log.clearEventAction(0);
+	m_currentEventActionId = -1;
+	return true;
+}
+
+int ActionLogRecorder::Thread::addString(ActionLogFile::Section section, const char* s) {
+	StringSet& cache = m_cache[section];
+	std::vector<int>& cache_index = m_cacheIndex[section];
+	std::vector<int>& global_index = m_globalIndex[section];
+	int size = cache.dataSize();
+	int index = cache.addString(s);
+	if (index < size) {
+		// The cache indices are added in increasing order, so the entry is found by
+		// a binary search.
+		size_t entry = std::lower_bound(cache_index.begin(), cache_index.end(), index) - cache_index.begin();
+		return global_index[entry];
+	}
+	lock_guard<mutex> lock(m_recorder->m_stringsMutex);
+	cache_index.push_back(index);
+	global_index.push_back(m_recorder->m_strings[section]->addString(s));
+	return global_index.back();
+}
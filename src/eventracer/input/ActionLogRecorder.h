@@ -0,0 +1,129 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ACTIONLOGRECORDER_H_
+#define ACTIONLOGRECORDER_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+#include "StringSet.h"
+#include "mutex.h"
+
+// Records an action log from several threads. Every recording thread gets its own
+// Thread object, which records the commands of its event actions without locking and
+// collects the event actions that ended in a buffer. flush moves the buffers of all
+// threads into one ActionLog, ordered by event action id.
+//
+// The strings are added to shared string sets. Every Thread keeps a cache of the
+// strings it has added, so only strings new to the thread take the shared lock.
+// While the recorder is used, strings must be added to the sets only through it.
+class ActionLogRecorder {
+public:
+	class Thread;
+
+	// js and mem_values can be NULL if these strings are not recorded.
+	ActionLogRecorder(StringSet* vars, StringSet* scopes, StringSet* js, StringSet* mem_values);
+	~ActionLogRecorder();
+
+	// Creates the recording state for a new thread. It is owned by the recorder and
+	// must be used by one thread at a time.
+	Thread* newThread();
+
+	// Moves the event actions that ended and the arcs of all threads to the log, which
+	// can have a writer. Must not be called from a thread in an event action and the
+	// log must not have an open event action. Each event action must be recorded by
+	// only one thread.
+	void flush(ActionLog* log);
+
+private:
+	// The event actions that ended in a thread since the last flush.
+	struct Buffer {
+		struct Entry {
+			int m_id;
+			ActionLog::EventActionType m_type;
+			size_t m_begin;
+			size_t m_end;
+		};
+		std::vector<Entry> m_eventActions;
+		std::vector<unsigned char> m_cmdTypes;
+		std::vector<int> m_cmdLocations;
+		std::vector<ActionLog::Arc> m_arcs;
+
+		void swap(Buffer* other);
+	};
+
+	StringSet* m_strings[ActionLogFile::NUM_SECTIONS];
+	// Guards adding to m_strings.
+	mutex m_stringsMutex;
+
+	std::vector<Thread*> m_threads;
+	// Guards m_threads.
+	mutex m_threadsMutex;
+
+	// Deleted.
+	ActionLogRecorder(const ActionLogRecorder&);
+	ActionLogRecorder& operator=(const ActionLogRecorder&);
+};
+
+// The recording state of one thread. Has the recording calls of ActionLog.
+class ActionLogRecorder::Thread {
+public:
+	void addArc(int earlier_event_action_id, int later_event_action_id, int arc_duration);
+
+	void startEventAction(int event_action_id);
+	bool endEventAction();
+	bool setEventActionType(ActionLog::EventActionType type) { return m_log.setEventActionType(type); }
+
+	bool enterScope(int scope_id) { return m_log.enterScope(scope_id); }
+	bool exitScope() { return m_log.exitScope(); }
+	bool willLogCommand(ActionLog::CommandType command) { return m_log.willLogCommand(command); }
+	bool logCommand(ActionLog::CommandType command, int location) { return m_log.logCommand(command, location); }
+
+	// Adds a string to the shared string set of a section and returns its index.
+	int addString(ActionLogFile::Section section, const char* s);
+
+private:
+	friend class ActionLogRecorder;
+
+	explicit Thread(ActionLogRecorder* recorder);
+
+	ActionLogRecorder* m_recorder;
+
+	// Records the current event action with id 0. Its commands are moved to m_buffer
+	// when it ends.
+	ActionLog m_log;
+	int m_currentEventActionId;
+
+	Buffer m_buffer;
+	// Guards m_buffer.
+	mutex m_bufferMutex;
+
+	// The strings added by this thread. For every string in m_cache, in the order it
+	// was added, m_cacheIndex has its index in m_cache and m_globalIndex its index in
+	// the shared set.
+	StringSet m_cache[ActionLogFile::NUM_SECTIONS];
+	std::vector<int> m_cacheIndex[ActionLogFile::NUM_SECTIONS];
+	std::vector<int> m_globalIndex[ActionLogFile::NUM_SECTIONS];
+
+	// Deleted.
+	Thread(const Thread&);
+	Thread& operator=(const Thread&);
+};
+
+#endif /* ACTIONLOGRECORDER_H_ */
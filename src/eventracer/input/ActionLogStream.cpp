@@ -0,0 +1,59 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLogStream.h"
+
+#include <stdio.h>
+#include "ActionLogFile.h"
+#include "StringSet.h"
+
+ActionLogStream::ActionLogStream() : m_numEventActions(0), m_numCommands(0) {
+}
+
+void ActionLogStream::addConsumer(ActionLogConsumer* consumer) {
+	m_consumers.push_back(consumer);
+}
+
+bool ActionLogStream::run(const char* filename, StringSet* vars, StringSet* scopes,
+		StringSet* js, StringSet* mem_values) {
+	// The mapped file is only read sequentially, so its pages do not need to stay in memory.
+	ActionLogFile file;
+	if (!file.open(filename)) {
+		fprintf(stderr, "Cannot open file %s\n", filename);
+		return false;
+	}
+	return file.load(vars, scopes, NULL, js, mem_values) && file.streamActions(this);
+}
+
+void ActionLogStream::consumeArcs(const std::vector<ActionLog::Arc>& arcs) {
+	for (size_t i = 0; i < m_consumers.size(); ++i) {
+		m_consumers[i]->consumeArcs(arcs);
+	}
+}
+
+void ActionLogStream::consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) {
+	++m_numEventActions;
+	m_numCommands += event_action.m_commands.size();
+	for (size_t i = 0; i < m_consumers.size(); ++i) {
+		m_consumers[i]->consumeEventAction(event_action_id, event_action);
+	}
+}
+
+void ActionLogStream::finish(int max_event_action_id) {
+	for (size_t i = 0; i < m_consumers.size(); ++i) {
+		m_consumers[i]->finish(max_event_action_id);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ACTIONLOGSTREAM_H_
+#define ACTIONLOGSTREAM_H_
+
+#include <vector>
+#include "ActionLog.h"
+#include "base.h"
+
+class StringSet;
+
+// Reads an ER_actionlog file and passes its event actions to a number of consumers
+// without keeping the commands in memory. Only the string sets are fully loaded.
+class ActionLogStream : public ActionLogConsumer {
+public:
+	ActionLogStream();
+
+	// Adds a consumer. The consumers are called in the order in which they were added.
+	void addConsumer(ActionLogConsumer* consumer);
+
+	// Reads the file. The js and mem_values sections are optional.
+	bool run(const char* filename, StringSet* vars, StringSet* scopes,
+			StringSet* js, StringSet* mem_values);
+
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs);
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action);
+	virtual void finish(int max_event_action_id);
+
+	int numEventActions() const { return m_numEventActions; }
+	int64 numCommands() const { return m_numCommands; }
+
+private:
+	std::vector<ActionLogConsumer*> m_consumers;
+	int m_numEventActions;
+	int64 m_numCommands;
+};
+
+#endif /* ACTIONLOGSTREAM_H_ */
@@ -0,0 +1,388 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+#include "ActionLogRecorder.h"
+#include "ActionLogWriter.h"
+#include "StringSet.h"
+#include "Varint.h"
+#include "thread_pool.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+void expectTrue(bool condition, const char* what) {
+	if (!condition) {
+		fprintf(stderr, "Test failed: %s\n^^^ FAIL ^^^\n", what);
+		throw 0;
+	}
+}
+
+void expectSameLog(const ActionLog& expected, const ActionLog& actual, const char* encoding) {
+	char what[128];
+	snprintf(what, sizeof(what), "%s: same max event action id", encoding);
+	expectTrue(expected.maxEventActionId() == actual.maxEventActionId(), what);
+	snprintf(what, sizeof(what), "%s: same arcs", encoding);
+	expectTrue(expected.arcs().size() == actual.arcs().size(), what);
+	for (size_t i = 0; i < expected.arcs().size(); ++i) {
+		expectTrue(expected.arcs()[i].m_tail == actual.arcs()[i].m_tail &&
+				expected.arcs()[i].m_head == actual.arcs()[i].m_head &&
+				expected.arcs()[i].m_duration == actual.arcs()[i].m_duration, what);
+	}
+	for (int id = 0; id <= expected.maxEventActionId(); ++id) {
+		ActionLog::EventAction e1 = expected.event_action(id);
+		ActionLog::EventAction e2 = actual.event_action(id);
+		snprintf(what, sizeof(what), "%s: same event action %d", encoding, id);
+		expectTrue(e1.m_type == e2.m_type && e1.m_commands.size() == e2.m_commands.size(), what);
+		for (size_t i = 0; i < e1.m_commands.size(); ++i) {
+			expectTrue(e1.m_commands[i] == e2.m_commands[i], what);
+		}
+	}
+}
+
+// Saves a log with one of the save functions and returns the written bytes.
+std::vector<char> saveLog(ActionLog* log, void (ActionLog::*save)(FILE*)) {
+	FILE* f = tmpfile();
+	expectTrue(f != NULL, "tmpfile");
+	(log->*save)(f);
+	std::vector<char> data(ftell(f));
+	rewind(f);
+	expectTrue(fread(data.data(), 1, data.size(), f) == data.size(), "read back the saved log");
+	fclose(f);
+	return data;
+}
+
+void testZigZag() {
+	printf("Starting test testZigZag...\n");
+	expectTrue(ZigZagEncode(0) == 0 && ZigZagEncode(-1) == 1 && ZigZagEncode(1) == 2, "small values");
+	expectTrue(ZigZagEncode(INT_MAX) == 0xfffffffeU, "encode INT_MAX");
+	expectTrue(ZigZagEncode(INT_MIN) == 0xffffffffU, "encode INT_MIN");
+	const int values[] = { 0, 1, -1, 63, -64, INT_MAX, INT_MIN, INT_MAX - 1, INT_MIN + 1 };
+	const int n = sizeof(values) / sizeof(values[0]);
+	for (int i = 0; i < n; ++i) {
+		expectTrue(ZigZagDecode(ZigZagEncode(values[i])) == values[i], "zigzag round trip");
+		for (int j = 0; j < n; ++j) {
+			expectTrue(ZigZagDecodeDelta(ZigZagEncodeDelta(values[i], values[j]), values[j]) == values[i],
+					"delta round trip");
+		}
+	}
+	expectTrue(ZigZagEncodeDelta(INT_MIN, INT_MAX) == 2, "delta wraps around");
+}
+
+void testVarint() {
+	printf("Starting test testVarint...\n");
+	const unsigned int values[] = { 0, 1, 127, 128, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0x7fffffff, 0xffffffff };
+	const size_t n = sizeof(values) / sizeof(values[0]);
+	std::vector<unsigned char> out;
+	for (size_t i = 0; i < n; ++i) {
+		AppendVarint(values[i], &out);
+	}
+	size_t pos = 0;
+	for (size_t i = 0; i < n; ++i) {
+		unsigned int value;
+		expectTrue(ReadVarint(out.data(), out.size(), &pos, &value) && value == values[i], "varint round trip");
+	}
+	expectTrue(pos == out.size(), "varints read to the end");
+
+	unsigned int value;
+	pos = out.size() - 5;  // The last value takes five bytes.
+	expectTrue(!ReadVarint(out.data(), out.size() - 1, &pos, &value), "truncated varint");
+}
+
+void testStreamVByte() {
+	printf("Starting test testStreamVByte...\n");
+	// The lengths cover every number of values after the last full group of four.
+	for (size_t n = 0; n <= 11; ++n) {
+		std::vector<unsigned int> values(n);
+		for (size_t i = 0; i < n; ++i) {
+			// Values of one to four bytes.
+			const unsigned int sizes[] = { 0x7f, 0x7fff, 0x7fffff, 0xffffffff };
+			values[i] = sizes[(i * 3 + n) % 4] - i;
+		}
+		std::vector<unsigned char> out;
+		out.push_back(0xaa);  // Data before the values.
+		AppendStreamVByte(values.data(), n, &out);
+		out.push_back(0x55);  // Data after the values.
+
+		std::vector<unsigned int> decoded((n + 3) / 4 * 4 + 1, 0x12345678);
+		size_t pos = 1;
+		expectTrue(ReadStreamVByte(out.data(), out.size(), &pos, n, decoded.data()), "read stream vbyte");
+		expectTrue(pos == out.size() - 1, "read stream vbyte to the end");
+		for (size_t i = 0; i < n; ++i) {
+			expectTrue(decoded[i] == values[i], "stream vbyte round trip");
+		}
+		expectTrue(decoded.back() == 0x12345678, "no writes after the padded values");
+
+		size_t skip_pos = 1;
+		expectTrue(SkipStreamVByte(out.data(), out.size(), &skip_pos, n) && skip_pos == pos, "skip stream vbyte");
+		if (n > 0) {
+			pos = 1;
+			expectTrue(!ReadStreamVByte(out.data(), out.size() - 2, &pos, n, decoded.data()), "truncated stream vbyte");
+		}
+	}
+}
+
+// Records a log with extreme locations, an event action without commands and event
+// actions with one to four commands.
+void recordTestLog(ActionLog* log) {
+	log->addArc(0, 1, -1);
+	log->addArc(1, 4, 10);
+	log->addArc(4, 2, 0);
+	log->addArc(6, 0, 3);
+
+	log->startEventAction(0);
+	log->setEventActionType(ActionLog::TIMER);
+	log->enterScope(INT_MAX);
+	log->logCommand(ActionLog::READ_MEMORY, INT_MIN);
+	log->logCommand(ActionLog::MEMORY_VALUE, -1);
+	log->logCommand(ActionLog::WRITE_MEMORY, INT_MAX);
+	log->logCommand(ActionLog::READ_MEMORY, INT_MAX);
+	log->logCommand(ActionLog::WRITE_MEMORY, INT_MIN);
+	log->logCommand(ActionLog::TRIGGER_ARC, 1);
+	log->exitScope();
+	log->endEventAction();
+
+	// No commands.
+	log->startEventAction(1);
+	log->setEventActionType(ActionLog::NETWORK);
+	log->endEventAction();
+
+	for (int n = 1; n <= 4; ++n) {
+		log->startEventAction(n + 2);
+		for (int i = 0; i < n; ++i) {
+			log->logCommand(ActionLog::WRITE_MEMORY, i % 2 == 0 ? INT_MIN + i : INT_MAX - i);
+		}
+		log->endEventAction();
+	}
+}
+
+void testCompactRoundTrip() {
+	printf("Starting test testCompactRoundTrip...\n");
+	ActionLog log;
+	recordTestLog(&log);
+
+	std::vector<char> data = saveLog(&log, &ActionLog::saveCompactToFile);
+	ActionLog loaded;
+	size_t pos = 0;
+	expectTrue(loaded.loadCompactFromMemory(data.data(), data.size(), &pos), "load compact");
+	expectTrue(pos == data.size(), "load compact to the end");
+	expectSameLog(log, loaded, "compact");
+
+	ThreadPool pool(2);
+	ActionLog loaded_in_parallel;
+	pos = 0;
+	expectTrue(loaded_in_parallel.loadCompactFromMemory(data.data(), data.size(), &pos, &pool),
+			"load compact in parallel");
+	expectSameLog(log, loaded_in_parallel, "compact in parallel");
+
+	for (size_t size = 0; size < data.size(); ++size) {
+		ActionLog truncated;
+		pos = 0;
+		expectTrue(!truncated.loadCompactFromMemory(data.data(), size, &pos), "truncated compact log");
+	}
+}
+
+void testColumnsRoundTrip() {
+	printf("Starting test testColumnsRoundTrip...\n");
+	ActionLog log;
+	recordTestLog(&log);
+
+	std::vector<char> data = saveLog(&log, &ActionLog::saveColumnsToFile);
+	ActionLog loaded;
+	size_t pos = 0;
+	expectTrue(loaded.loadColumnsFromMemory(data.data(), data.size(), &pos), "load columns");
+	expectTrue(pos == data.size(), "load columns to the end");
+	expectSameLog(log, loaded, "columns");
+
+	// Changing a loaded event action copies it and leaves the others in place.
+	loaded.setCommandLocation(0, 1, 42);
+	expectTrue(loaded.event_action(0).m_commands.location(1) == 42, "changed location");
+	log.setCommandLocation(0, 1, 42);
+	expectSameLog(log, loaded, "changed columns");
+
+	for (size_t size = 0; size < data.size(); ++size) {
+		ActionLog truncated;
+		pos = 0;
+		expectTrue(!truncated.loadColumnsFromMemory(data.data(), size, &pos), "truncated columns log");
+	}
+}
+
+// Records event actions 1 and 2, then enters both of them again.
+void recordReenteredLog(ActionLog* log) {
+	log->addArc(1, 2, -1);
+	log->startEventAction(1);
+	log->logCommand(ActionLog::WRITE_MEMORY, 10);
+	log->endEventAction();
+	log->startEventAction(2);
+	log->logCommand(ActionLog::READ_MEMORY, 10);
+	log->endEventAction();
+	log->startEventAction(1);
+	log->setEventActionType(ActionLog::CONTINUATION);
+	log->logCommand(ActionLog::READ_MEMORY, 11);
+	log->logCommand(ActionLog::WRITE_MEMORY, 10);
+	log->endEventAction();
+	log->addArc(2, 3, -1);
+	log->startEventAction(3);
+	log->endEventAction();
+	log->startEventAction(2);
+	log->logCommand(ActionLog::WRITE_MEMORY, 12);
+	log->endEventAction();
+}
+
+// Records a log with an ActionLogWriter, which writes a version 3 file.
+void writeJournal(const char* filename, void (*record)(ActionLog*), size_t buffer_size) {
+	StringSet vars, scopes;
+	ActionLogWriter writer;
+	expectTrue(writer.open(filename, &vars, &scopes, NULL, NULL, buffer_size), "open writer");
+	ActionLog recorded;
+	recorded.setWriter(&writer);
+	record(&recorded);
+	recorded.setWriter(NULL);
+	expectTrue(writer.close(), "close writer");
+}
+
+// Adds a streamed log to another log.
+class LogRebuilder : public ActionLogConsumer {
+public:
+	explicit LogRebuilder(ActionLog* log) : m_log(log) {}
+
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs) {
+		for (size_t i = 0; i < arcs.size(); ++i) {
+			m_log->addArc(arcs[i].m_tail, arcs[i].m_head, arcs[i].m_duration);
+		}
+	}
+
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) {
+		m_log->copyEventAction(event_action_id, event_action);
+	}
+
+private:
+	ActionLog* m_log;
+};
+
+void testJournalStream() {
+	printf("Starting test testJournalStream...\n");
+	ActionLog log;
+	recordTestLog(&log);
+
+	char filename[] = "/tmp/actionlogtestXXXXXX";
+	int fd = mkstemp(filename);
+	expectTrue(fd >= 0, "mkstemp");
+	close(fd);
+	// One block for every event action.
+	writeJournal(filename, recordTestLog, 1);
+	ActionLogFile file;
+	expectTrue(file.open(filename), "open written log");
+	ActionLog streamed;
+	LogRebuilder rebuilder(&streamed);
+	expectTrue(file.streamActions(&rebuilder), "stream written log");
+	expectSameLog(log, streamed, "streamed blocks");
+
+	// Event actions entered again cannot be streamed.
+	writeJournal(filename, recordReenteredLog, 1);
+	ActionLogFile reentered_file;
+	expectTrue(reentered_file.open(filename), "open reentered log");
+	ActionLog reentered;
+	LogRebuilder reentered_rebuilder(&reentered);
+	expectTrue(!reentered_file.streamActions(&reentered_rebuilder), "stream reentered log");
+	unlink(filename);
+}
+
+void testReentryRoundTrip() {
+	printf("Starting test testReentryRoundTrip...\n");
+	ActionLog log;
+	recordReenteredLog(&log);
+
+	char filename[] = "/tmp/actionlogtestXXXXXX";
+	int fd = mkstemp(filename);
+	expectTrue(fd >= 0, "mkstemp");
+	close(fd);
+	// Written in one buffer and with a buffer for every event action.
+	const size_t buffer_sizes[] = { ActionLogWriter::DEFAULT_BUFFER_SIZE, 1 };
+	for (int i = 0; i < 2; ++i) {
+		writeJournal(filename, recordReenteredLog, buffer_sizes[i]);
+		ActionLogFile file;
+		expectTrue(file.open(filename), "open written log");
+		ActionLog loaded;
+		expectTrue(file.loadActions(&loaded), "load written log");
+		expectSameLog(log, loaded, "reentered");
+
+		ThreadPool pool(2);
+		ActionLog loaded_in_parallel;
+		expectTrue(file.loadActions(&loaded_in_parallel, &pool), "load written log in parallel");
+		expectSameLog(log, loaded_in_parallel, "reentered in parallel");
+	}
+	unlink(filename);
+}
+
+void testNegativeEventActionId() {
+	printf("Starting test testNegativeEventActionId...\n");
+	ActionLog log;
+	log.startEventAction(-2);
+	expectTrue(!log.logCommand(ActionLog::READ_MEMORY, 1), "no command in a negative event action");
+	expectTrue(!log.endEventAction(), "no negative event action entered");
+	expectTrue(!log.hasEventAction(-2) && log.maxEventActionId() == -1, "no negative event action added");
+	ActionLog::EventAction event_action;
+	expectTrue(!log.copyEventAction(-1, event_action), "negative event action not copied");
+
+	log.startEventAction(0);
+	expectTrue(log.logCommand(ActionLog::READ_MEMORY, 1), "command after a negative event action");
+	expectTrue(log.endEventAction(), "event action 0 entered");
+	expectTrue(log.maxEventActionId() == 0 && log.event_action(0).m_commands.size() == 1, "event action 0 added");
+}
+
+void testRecorderStrings() {
+	printf("Starting test testRecorderStrings...\n");
+	StringSet vars, scopes;
+	vars.addString("shared");
+	ActionLogRecorder recorder(&vars, &scopes, NULL, NULL);
+	ActionLogRecorder::Thread* threads[2] = { recorder.newThread(), recorder.newThread() };
+	char s[32];
+	// Each thread adds the strings in another order and most of them several times.
+	for (int round = 0; round < 3; ++round) {
+		for (int i = 0; i < 500; ++i) {
+			for (int t = 0; t < 2; ++t) {
+				snprintf(s, sizeof(s), "var %d", t == 0 ? i : 499 - i);
+				int index = threads[t]->addString(ActionLogFile::VARS, s);
+				expectTrue(index == vars.findString(s), "index in the shared set");
+				expectTrue(threads[t]->addString(ActionLogFile::SCOPES, s) == scopes.findString(s),
+						"index in the shared scopes");
+			}
+		}
+		expectTrue(threads[round % 2]->addString(ActionLogFile::VARS, "shared") == 0, "string added before");
+	}
+	expectTrue(vars.numEntries() == 501 && scopes.numEntries() == 500, "strings added once");
+}
+
+int main(void) {
+	testZigZag();
+	testVarint();
+	testStreamVByte();
+	testCompactRoundTrip();
+	testColumnsRoundTrip();
+	testReentryRoundTrip();
+	testJournalStream();
+	testNegativeEventActionId();
+	testRecorderStrings();
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "ActionLogWriter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "StringSet.h"
+#include "thread_pool.h"
+
+namespace {
+
+bool WriteAll(int fd, const char* data, size_t size) {
+	while (size > 0) {
+		ssize_t written = write(fd, data, size);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+}  // namespace
+
+class ActionLogWriter::WriteTask : public ThreadTask {
+public:
+	explicit WriteTask(ActionLogWriter* writer) : m_writer(writer) {}
+
+	virtual void run() { m_writer->writeBuffer(); }
+
+private:
+	ActionLogWriter* m_writer;
+};
+
+void ActionLogWriter::appendBlockHeader(int section, int64 size, std::vector<char>* out) {
+	ActionLogFile::JournalBlock block;
+	block.section = section;
+	block.encoding = ActionLogFile::RAW;
+	block.size = size;
+	const char* p = reinterpret_cast<const char*>(&block);
+	out->insert(out->end(), p, p + sizeof(block));
+}
+
+ActionLogWriter::ActionLogWriter()
+	: m_fd(-1), m_bufferSize(DEFAULT_BUFFER_SIZE), m_numEventActions(0), m_hasActions(false), m_fileSize(0),
+	  m_failed(false), m_pool(NULL), m_task(NULL) {
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		m_strings[i] = NULL;
+		m_writtenStringsSize[i] = -1;
+	}
+}
+
+ActionLogWriter::~ActionLogWriter() {
+	close();
+}
+
+bool ActionLogWriter::open(const char* filename, const StringSet* vars, const StringSet* scopes,
+		const StringSet* js, const StringSet* mem_values, size_t buffer_size) {
+	close();
+	m_fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (m_fd < 0) {
+		fprintf(stderr, "Cannot create %s\n", filename);
+		return false;
+	}
+	m_bufferSize = buffer_size;
+	m_strings[ActionLogFile::VARS] = vars;
+	m_strings[ActionLogFile::SCOPES] = scopes;
+	m_strings[ActionLogFile::ACTIONS] = NULL;
+	m_strings[ActionLogFile::JS] = js;
+	m_strings[ActionLogFile::MEM_VALUES] = mem_values;
+	m_failed = false;
+
+	ActionLogFile::FileHeader hdr;
+	memcpy(hdr.magic, ActionLogFile::kMagic, sizeof(hdr.magic));
+	hdr.version = 3;
+	hdr.num_sections = 0;
+	m_fileSize = sizeof(hdr) + sizeof(m_fileSize);
+	std::vector<char> out(reinterpret_cast<const char*>(&hdr), reinterpret_cast<const char*>(&hdr) + sizeof(hdr));
+	out.insert(out.end(), reinterpret_cast<const char*>(&m_fileSize),
+			reinterpret_cast<const char*>(&m_fileSize) + sizeof(m_fileSize));
+	if (!WriteAll(m_fd, out.data(), out.size())) {
+		fprintf(stderr, "Cannot write %s\n", filename);
+		::close(m_fd);
+		m_fd = -1;
+		return false;
+	}
+
+	m_pool = new ThreadPool(1);
+	m_task = new WriteTask(this);
+	// Write all sections right away, so that even an empty log is readable.
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		m_writtenStringsSize[i] = -1;
+	}
+	m_arcs.clear();
+	m_eventActions.clear();
+	m_numEventActions = 0;
+	m_hasActions = false;
+	flush();
+	return true;
+}
+
+void ActionLogWriter::addArc(const ActionLog::Arc& arc) {
+	m_arcs.push_back(arc);
+}
+
+void ActionLogWriter::addEventAction(int id, const ActionLog::EventAction& event_action) {
+	ActionLog::appendEventAction(id, event_action, &m_eventActions);
+	++m_numEventActions;
+	if (m_eventActions.size() >= m_bufferSize) flush();
+}
+
+void ActionLogWriter::flush() {
+	if (m_fd < 0) return;
+	// Wait until the previous buffer is written.
+	m_pool->wait();
+	m_writeHead.clear();
+	// The strings come first, so that the event actions only refer to written strings.
+	for (int i = 0; i < ActionLogFile::NUM_SECTIONS; ++i) {
+		if (m_strings[i] == NULL) continue;
+		int size = m_strings[i]->dataSize();
+		if (size == m_writtenStringsSize[i]) continue;
+		int begin = m_writtenStringsSize[i] < 0 ? 0 : m_writtenStringsSize[i];
+		appendBlockHeader(i, size - begin, &m_writeHead);
+		m_strings[i]->appendData(begin, &m_writeHead);
+		m_writtenStringsSize[i] = size;
+	}
+	if (m_hasActions && m_writeHead.empty() && m_arcs.empty() && m_numEventActions == 0) return;
+	m_hasActions = true;
+	size_t actions_begin = m_writeHead.size();
+	appendBlockHeader(ActionLogFile::ACTIONS, 0, &m_writeHead);
+	ActionLog::appendHeader(m_numEventActions, m_arcs, &m_writeHead);
+	int64 actions_size = m_writeHead.size() - actions_begin - sizeof(ActionLogFile::JournalBlock) +
+			m_eventActions.size();
+	memcpy(&m_writeHead[actions_begin] + offsetof(ActionLogFile::JournalBlock, size),
+			&actions_size, sizeof(actions_size));
+	m_writeEventActions.swap(m_eventActions);
+	m_eventActions.clear();
+	m_arcs.clear();
+	m_numEventActions = 0;
+	m_pool->add(m_task);
+}
+
+void ActionLogWriter::writeBuffer() {
+	if (m_failed) return;
+	if (!WriteAll(m_fd, m_writeHead.data(), m_writeHead.size()) ||
+			!WriteAll(m_fd, m_writeEventActions.data(), m_writeEventActions.size())) {
+		m_failed = true;
+		return;
+	}
+	m_fileSize += m_writeHead.size() + m_writeEventActions.size();
+	// Only now the header includes the new data.
+	if (pwrite(m_fd, &m_fileSize, sizeof(m_fileSize), sizeof(ActionLogFile::FileHeader)) !=
+			static_cast<ssize_t>(sizeof(m_fileSize))) {
+		m_failed = true;
+	}
+}
+
+bool ActionLogWriter::close() {
+	if (m_fd < 0) return !m_failed;
+	flush();
+	m_pool->wait();
+	delete m_pool;
+	m_pool = NULL;
+	delete m_task;
+	m_task = NULL;
+	if (::close(m_fd) != 0) m_failed = true;
+	m_fd = -1;
+	m_writeHead.clear();
+	m_writeEventActions.clear();
+	if (m_failed) fprintf(stderr, "Writing the action log failed\n");
+	return !m_failed;
+}
@@ -0,0 +1,106 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ACTIONLOGWRITER_H_
+#define ACTIONLOGWRITER_H_
+
+#include <stddef.h>
+#include <vector>
+
+#include "base.h"
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+
+class StringSet;
+class ThreadPool;
+
+// Writes an ER_actionlog while it is recorded, so that the recorded event actions do
+// not need to stay in memory and there is no long save at the end. Event actions and
+// arcs are collected in a buffer, which a background thread writes while the next one
+// is filled. Together with them, the strings added since the previous buffer are
+// written. At most two buffers are in memory, so if the disk is slower than the
+// recording, adding an event action waits for the previous buffer to be written.
+//
+// The result is a version 3 ER_actionlog. Its header is updated after every buffer is
+// written, so if the recording crashes, the file is readable and only the buffers
+// not written yet are lost. convertlog rewrites it as a version 2 file.
+//
+// The writer is used from a single thread, usually through ActionLog::setWriter.
+class ActionLogWriter {
+public:
+	enum { DEFAULT_BUFFER_SIZE = 4 << 20 };
+
+	ActionLogWriter();
+	~ActionLogWriter();
+
+	// Creates the file. The string sets are written as they grow, js and mem_values
+	// can be NULL. A buffer is written once its event actions take buffer_size bytes.
+	bool open(const char* filename, const StringSet* vars, const StringSet* scopes,
+			const StringSet* js, const StringSet* mem_values, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+	void addArc(const ActionLog::Arc& arc);
+
+	// Adds an event action that ended. An event action that is entered again is added
+	// again with its new commands. Loading the file appends them to the earlier ones,
+	// but such a file can only be streamed after convertlog.
+	void addEventAction(int id, const ActionLog::EventAction& event_action);
+
+	// Passes the collected data to the background thread.
+	void flush();
+
+	// Writes the remaining data and closes the file. Returns false if any write failed.
+	bool close();
+
+private:
+	class WriteTask;
+	friend class WriteTask;
+
+	static void appendBlockHeader(int section, int64 size, std::vector<char>* out);
+
+	// Runs on the background thread.
+	void writeBuffer();
+
+	int m_fd;
+	size_t m_bufferSize;
+	const StringSet* m_strings[ActionLogFile::NUM_SECTIONS];
+	// The size of the string data already passed to the background thread, -1 before
+	// the first flush.
+	int m_writtenStringsSize[ActionLogFile::NUM_SECTIONS];
+
+	// Collected since the last flush.
+	std::vector<ActionLog::Arc> m_arcs;
+	std::vector<char> m_eventActions;
+	int m_numEventActions;
+	// Whether an actions block was passed to the background thread.
+	bool m_hasActions;
+
+	// Being written by the background thread: the string blocks and the header of
+	// the actions block, and the event actions.
+	std::vector<char> m_writeHead;
+	std::vector<char> m_writeEventActions;
+	// Only accessed by the background thread while it writes.
+	int64 m_fileSize;
+	bool m_failed;
+
+	ThreadPool* m_pool;
+	WriteTask* m_task;
+
+	// Deleted.
+	ActionLogWriter(const ActionLogWriter&);
+	ActionLogWriter& operator=(const ActionLogWriter&);
+};
+
+#endif /* ACTIONLOGWRITER_H_ */
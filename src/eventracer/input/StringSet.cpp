@@ -15,9 +15,119 @@
  */
 
 #include "StringSet.h"
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
-StringSet::StringSet() : m_hashTableLoad(0) {
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const unsigned char EMPTY = 0x80;
+
+__extension__ typedef unsigned __int128 uint128;
+
+inline uint64_t Mix(uint64_t a, uint64_t b) {
+	uint128 r = static_cast<uint128>(a) * b;
+	return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+inline uint64_t Read64(const unsigned char* p) {
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline uint64_t Read32(const unsigned char* p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// A wyhash-style hash. Reads up to 16 bytes per multiplication instead of one
+// byte per step.
+uint64_t HashBytes(const unsigned char* p, size_t len) {
+	const uint64_t k0 = 0xa0761d6478bd642fULL, k1 = 0xe7037ed1a0b428dbULL;
+	const uint64_t k2 = 0x8ebc6af09c88c6e3ULL, k3 = 0x589965cc75374cc3ULL;
+	uint64_t seed = k0;
+	uint64_t a, b;
+	if (len <= 16) {
+		if (len >= 4) {
+			size_t mid = (len >> 3) << 2;
+			a = (Read32(p) << 32) | Read32(p + mid);
+			b = (Read32(p + len - 4) << 32) | Read32(p + len - 4 - mid);
+		} else if (len > 0) {
+			a = (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+		if (i > 48) {
+			uint64_t seed1 = seed, seed2 = seed;
+			do {
+				seed = Mix(Read64(p) ^ k1, Read64(p + 8) ^ seed);
+				seed1 = Mix(Read64(p + 16) ^ k2, Read64(p + 24) ^ seed1);
+				seed2 = Mix(Read64(p + 32) ^ k3, Read64(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (i > 16) {
+			seed = Mix(Read64(p) ^ k1, Read64(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = Read64(p + i - 16);
+		b = Read64(p + i - 8);
+	}
+	return Mix(k1 ^ len, Mix(a ^ k1, b ^ seed));
+}
+
+// Copies the control bytes of a group. A writer may set any of them at the same
+// time, so they are read with atomic loads. Acquiring them makes the slots they
+// were released with visible.
+inline void LoadGroup(const unsigned char* group, unsigned char* out) {
+	for (int i = 0; i < 16; ++i) {
+		out[i] = __atomic_load_n(&group[i], __ATOMIC_ACQUIRE);
+	}
+}
+
+// Returns a bit mask of the control bytes in a group that are equal to c.
+inline unsigned int MatchGroup(const unsigned char* group, unsigned char c) {
+#if defined(__SSE2__)
+	__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(c))));
+#else
+	unsigned int result = 0;
+	for (int i = 0; i < 16; ++i) {
+		if (group[i] == c) result |= 1u << i;
+	}
+	return result;
+#endif
+}
+
+}  // namespace
+
+StringSet::HashTable::HashTable(size_t capacity)
+	: m_capacity(capacity), m_control(new unsigned char[capacity]), m_slots(new Slot[capacity]) {
+	memset(m_control, EMPTY, capacity);
+}
+
+StringSet::HashTable::~HashTable() {
+	delete[] m_control;
+	delete[] m_slots;
+}
+
+StringSet::StringSet() : m_numChunks(0), m_dataSize(0), m_table(NULL), m_hashTableLoad(0) {
+}
+
+StringSet::~StringSet() {
+	clear();
 }
 
 int StringSet::addString(const char* s) {
@@ -25,7 +135,14 @@ int StringSet::addString(const char* s) {
 }
 
 const char* StringSet::getString(int index) const {
-	return m_data.data() + index;
+	// Find the last chunk that starts at or before index.
+	int lo = 0;
+	int hi = __atomic_load_n(&m_numChunks, __ATOMIC_ACQUIRE) - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (m_chunks[mid].m_begin <= index) lo = mid; else hi = mid - 1;
+	}
+	return m_chunks[lo].m_data + (index - m_chunks[lo].m_begin);
 }
 
 bool StringSet::containsString(const char* s) const {
@@ -39,81 +156,267 @@ int StringSet::findString(const char* s) {
 }
 
 int StringSet::addStringL(const char* s, int slen) {
-	int hash = stringHash(s, slen);
+	unsigned int hash = stringHash(s, slen);
 	int pos = findStringL(s, slen, hash);
 	if (pos == -1) {
-		pos = m_data.size();
-		addHash(hash, pos);
-		m_data.insert(m_data.end(), s, s + slen + 1);
+		pos = m_dataSize;
+		memcpy(allocateString(slen), s, slen + 1);
+		m_dataSize += slen + 1;
+		addHash(hash, pos, slen);
 	}
 	return pos;
 }
 
-int StringSet::findStringL(const char* s, int slen, int hash) const {
-	if (m_hashes.size() == 0) return -1;
-	size_t p = hash % m_hashes.size();
-	while (m_hashes[p] != -1) {
-		const char* s1 = getString(m_hashes[p]);
-		if (strcmp(s, s1) == 0) return m_hashes[p];
-		++p;
-		if (p == m_hashes.size()) p = 0;
+char* StringSet::allocateString(int slen) {
+	if (m_numChunks > 0) {
+		const Chunk& last = m_chunks[m_numChunks - 1];
+		if (m_dataSize - last.m_begin + slen + 1 <= last.m_capacity) {
+			return last.m_data + (m_dataSize - last.m_begin);
+		}
+	}
+	if (m_numChunks == MAX_CHUNKS) {
+		fprintf(stderr, "StringSet: Too many chunks\n");
+		abort();
+	}
+	Chunk& chunk = m_chunks[m_numChunks];
+	chunk.m_capacity = MIN_CHUNK_SIZE;
+	if (chunk.m_capacity < m_dataSize / 2) chunk.m_capacity = m_dataSize / 2;
+	if (chunk.m_capacity < slen + 1) chunk.m_capacity = slen + 1;
+	chunk.m_data = new char[chunk.m_capacity];
+	chunk.m_begin = m_dataSize;
+	// Publish the chunk only once it is filled in.
+	__atomic_store_n(&m_numChunks, m_numChunks + 1, __ATOMIC_RELEASE);
+	return chunk.m_data;
+}
+
+// The slots are probed a group at a time. The group of a hash is given by its
+// high bits and its control byte by the low 7 bits, so a probe compares 16
+// control bytes at once and looks at a slot only on a 7-bit match. Since strings
+// are never removed, a group with an empty slot ends the probe sequence.
+//
+// A writer fills in a slot before it sets the control byte, and a reader looks at
+// a slot only after it has seen its control byte. Readers copy a group with
+// atomic loads and match the copy; the writer reads its own control bytes directly.
+int StringSet::findStringL(const char* s, int slen, unsigned int hash) const {
+	const HashTable* table = __atomic_load_n(&m_table, __ATOMIC_ACQUIRE);
+	if (table == NULL) return -1;
+	size_t group_mask = table->m_capacity / GROUP_SIZE - 1;
+	size_t group = (hash >> 7) & group_mask;
+	unsigned char h2 = hash & 0x7f;
+	for (size_t step = 1; ; ++step) {
+		unsigned char ctrl[GROUP_SIZE];
+		LoadGroup(table->m_control + group * GROUP_SIZE, ctrl);
+		unsigned int match = MatchGroup(ctrl, h2);
+		unsigned int empty = MatchGroup(ctrl, EMPTY);
+		for (; match != 0; match &= match - 1) {
+			const Slot& slot = table->m_slots[group * GROUP_SIZE + __builtin_ctz(match)];
+			if (slot.m_hash == hash && slot.m_length == slen &&
+					memcmp(getString(slot.m_index), s, slen) == 0) {
+				return slot.m_index;
+			}
+		}
+		if (empty != 0) return -1;
+		group = (group + step) & group_mask;
 	}
-	return -1;
 }
 
-int StringSet::stringHash(const char* s, int slen) const {
-    unsigned long hash = 5381;
-    for (int i = 0; i < slen; ++i) {
-        hash = ((hash << 5) + hash) + static_cast<unsigned int>(s[i]);
-    }
-    return hash;
+unsigned int StringSet::stringHash(const char* s, int slen) {
+	uint64_t hash = HashBytes(reinterpret_cast<const unsigned char*>(s), slen);
+	return static_cast<unsigned int>(hash ^ (hash >> 32));
 }
 
-void StringSet::addHash(int hash, int value) {
-	while (static_cast<size_t>(m_hashTableLoad * 2) >= m_hashes.size()) {
-		m_hashes.assign(m_hashes.size() * 2 + 3, -1);
-		rehashAll();
+void StringSet::addHash(unsigned int hash, int value, int slen) {
+	// Keep the load at most 7/8.
+	size_t capacity = m_table == NULL ? 0 : m_table->m_capacity;
+	if (static_cast<size_t>(m_hashTableLoad + 1) * 8 > capacity * 7) {
+		resizeHashTable(capacity == 0 ? GROUP_SIZE : capacity * 2);
 	}
-	addHashNoRehash(hash, value);
+	addHashNoRehash(m_table, hash, value, slen);
+	__atomic_store_n(&m_hashTableLoad, m_hashTableLoad + 1, __ATOMIC_RELEASE);
 }
 
-void StringSet::addHashNoRehash(int hash, int value) {
-	++m_hashTableLoad;
-	size_t p = hash % m_hashes.size();
-	while (m_hashes[p] != -1) {
-		++p;
-		if (p == m_hashes.size()) p = 0;
+void StringSet::addHashNoRehash(HashTable* table, unsigned int hash, int value, int slen) {
+	size_t group_mask = table->m_capacity / GROUP_SIZE - 1;
+	size_t group = (hash >> 7) & group_mask;
+	for (size_t step = 1; ; ++step) {
+		unsigned int empty = MatchGroup(table->m_control + group * GROUP_SIZE, EMPTY);
+		if (empty != 0) {
+			size_t p = group * GROUP_SIZE + __builtin_ctz(empty);
+			table->m_slots[p].m_index = value;
+			table->m_slots[p].m_length = slen;
+			table->m_slots[p].m_hash = hash;
+			__atomic_store_n(&table->m_control[p], static_cast<unsigned char>(hash & 0x7f), __ATOMIC_RELEASE);
+			return;
+		}
+		group = (group + step) & group_mask;
+	}
+}
+
+void StringSet::resizeHashTable(size_t capacity) {
+	HashTable* table = new HashTable(capacity);
+	if (m_table != NULL) {
+		for (size_t i = 0; i < m_table->m_capacity; ++i) {
+			if (m_table->m_control[i] != EMPTY) {
+				const Slot& slot = m_table->m_slots[i];
+				addHashNoRehash(table, slot.m_hash, slot.m_index, slot.m_length);
+			}
+		}
+		m_oldTables.push_back(m_table);
+	}
+	__atomic_store_n(&m_table, table, __ATOMIC_RELEASE);
+}
+
+void StringSet::appendData(int begin, std::vector<char>* out) const {
+	for (int c = 0; c < m_numChunks; ++c) {
+		int chunk_end = c + 1 < m_numChunks ? m_chunks[c + 1].m_begin : m_dataSize;
+		if (chunk_end <= begin) continue;
+		int from = begin > m_chunks[c].m_begin ? begin : m_chunks[c].m_begin;
+		const char* data = m_chunks[c].m_data + (from - m_chunks[c].m_begin);
+		out->insert(out->end(), data, data + (chunk_end - from));
 	}
-	m_hashes[p] = value;
 }
 
 void StringSet::rehashAll() {
-	m_hashTableLoad = 0;
-	size_t pos = 0;
-	while (pos < m_data.size()) {
+	// Size the table for all strings up front.
+	size_t num_strings = 0;
+	for (int c = 0; c < m_numChunks; ++c) {
+		int size = (c + 1 < m_numChunks ? m_chunks[c + 1].m_begin : m_dataSize) - m_chunks[c].m_begin;
+		for (int i = 0; i < size; ++i) {
+			if (m_chunks[c].m_data[i] == 0) ++num_strings;
+		}
+	}
+	size_t capacity = GROUP_SIZE;
+	while (num_strings * 8 > capacity * 7) capacity *= 2;
+	resizeHashTable(capacity);
+	int pos = 0;
+	while (pos < m_dataSize) {
 		const char* str = getString(pos);
 		int len = strlen(str);
-		addHashNoRehash(stringHash(str, len), pos);
+		addHash(stringHash(str, len), pos, len);
 		pos += len + 1;
 	}
 }
 
+void StringSet::assignData(const char* data, int size) {
+	clear();
+	if (size == 0) return;
+	m_chunks[0].m_data = new char[size];
+	m_chunks[0].m_begin = 0;
+	m_chunks[0].m_capacity = size;
+	memcpy(m_chunks[0].m_data, data, size);
+	m_numChunks = 1;
+	m_dataSize = size;
+}
+
+void StringSet::clear() {
+	for (int c = 0; c < m_numChunks; ++c) {
+		delete[] m_chunks[c].m_data;
+	}
+	m_numChunks = 0;
+	m_dataSize = 0;
+	for (size_t i = 0; i < m_oldTables.size(); ++i) {
+		delete m_oldTables[i];
+	}
+	m_oldTables.clear();
+	delete m_table;
+	m_table = NULL;
+	m_hashTableLoad = 0;
+}
+
 void StringSet::saveToFile(FILE* f) {
-	int n = m_data.size();
+	int n = m_dataSize;
 	fwrite(&n, sizeof(int), 1, f);
-	fwrite(m_data.data(), sizeof(char), m_data.size(), f);
-	n = m_hashes.size();
+	for (int c = 0; c < m_numChunks; ++c) {
+		int end = c + 1 < m_numChunks ? m_chunks[c + 1].m_begin : m_dataSize;
+		fwrite(m_chunks[c].m_data, sizeof(char), end - m_chunks[c].m_begin, f);
+	}
+	n = m_table == NULL ? 0 : m_table->m_capacity;
 	fwrite(&n, sizeof(int), 1, f);
 }
 
 bool StringSet::loadFromFile(FILE* f) {
 	int n = 0;
+	if (fread(&n, sizeof(int), 1, f) != 1 || n < 0) return false;
+	std::vector<char> data(n, 0);
+	if (fread(data.data(), sizeof(char), n, f) != data.size()) return false;
+	assignData(data.data(), n);
 	if (fread(&n, sizeof(int), 1, f) != 1) return false;
-	m_data.resize(n, 0);
-	if (fread(m_data.data(), sizeof(char), n, f) != m_data.size()) return false;
-	if (fread(&n, sizeof(int), 1, f) != 1) return false;
-	m_hashes.assign(n, -1);
 	rehashAll();
 	return true;
 }
 
+bool StringSet::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	int n = 0;
+	if (size - *pos < sizeof(int)) return false;
+	memcpy(&n, data + *pos, sizeof(int));
+	*pos += sizeof(int);
+	if (n < 0 || size - *pos < static_cast<size_t>(n)) return false;
+	assignData(data + *pos, n);
+	*pos += n;
+	if (size - *pos < sizeof(int)) return false;
+	*pos += sizeof(int);
+	rehashAll();
+	return true;
+}
+
+void StringSet::saveIndexedToFile(FILE* f) {
+	saveToFile(f);
+	int header[2] = { HASH_FUNCTION_ID, m_hashTableLoad };
+	fwrite(header, sizeof(int), 2, f);
+	if (m_table != NULL) {
+		fwrite(m_table->m_control, sizeof(unsigned char), m_table->m_capacity, f);
+		fwrite(m_table->m_slots, sizeof(Slot), m_table->m_capacity, f);
+	}
+}
+
+bool StringSet::loadIndexedFromMemory(const char* data, size_t size, size_t* pos) {
+	int n = 0;
+	if (size - *pos < sizeof(int)) return false;
+	memcpy(&n, data + *pos, sizeof(int));
+	*pos += sizeof(int);
+	if (n < 0 || size - *pos < static_cast<size_t>(n)) return false;
+	assignData(data + *pos, n);
+	*pos += n;
+	int header[3];  // Hash table size, hash function and load.
+	if (size - *pos < sizeof(header)) return false;
+	memcpy(header, data + *pos, sizeof(header));
+	*pos += sizeof(header);
+	size_t capacity = header[0];
+	if (header[0] < 0) return false;
+	if (header[1] != HASH_FUNCTION_ID) return false;
+	if ((size - *pos) / (sizeof(Slot) + 1) < capacity) return false;
+	const unsigned char* control = reinterpret_cast<const unsigned char*>(data + *pos);
+	*pos += capacity;
+	const char* slots = data + *pos;
+	*pos += sizeof(Slot) * capacity;
+	// Only trust a hash table whose slots each point to a whole string of the data:
+	// one that starts at index 0 or after a NUL and has a NUL at its length. The
+	// hashes are not checked: a slot with a wrong hash makes lookups of its string
+	// miss, and addString would add the string again.
+	bool valid = capacity > 0 && capacity % GROUP_SIZE == 0 && (capacity & (capacity - 1)) == 0 &&
+			(n == 0 || getString(n - 1)[0] == 0);
+	if (valid) {
+		HashTable* table = new HashTable(capacity);
+		memcpy(table->m_control, control, capacity);
+		memcpy(table->m_slots, slots, sizeof(Slot) * capacity);
+		int load = 0;
+		for (size_t i = 0; valid && i < capacity; ++i) {
+			if (table->m_control[i] == EMPTY) continue;
+			const Slot& slot = table->m_slots[i];
+			valid = table->m_control[i] == (slot.m_hash & 0x7f) && slot.m_index >= 0 && slot.m_length >= 0 &&
+					static_cast<int64_t>(slot.m_index) + slot.m_length < n &&
+					(slot.m_index == 0 || getString(slot.m_index - 1)[0] == 0) &&
+					getString(slot.m_index)[slot.m_length] == 0;
+			++load;
+		}
+		// Probing needs at least one empty slot.
+		if (valid && load == header[2] && static_cast<size_t>(load) < capacity) {
+			m_table = table;
+			m_hashTableLoad = load;
+			return true;
+		}
+		delete table;
+	}
+	rehashAll();
+	return true;
+}
@@ -17,18 +17,26 @@
 #ifndef STRINGSET_H_
 #define STRINGSET_H_
 
+#include <stddef.h>
 #include <stdio.h>
 #include <vector>
 
+// A set of strings, each identified by an index. The strings are stored in chunks
+// that never move, so returned string pointers stay valid.
+//
+// Lookups (getString, containsString, findString and numEntries) may run on any
+// number of threads concurrently with one thread calling addString. Loading and
+// saving need exclusive access.
 class StringSet {
 public:
 	StringSet();
+	~StringSet();
 
 	// Returns the index of the added string.
 	int addString(const char* s);
 
-	// Returns the string for an index. The returned pointer is guaranteed
-	// to be valid only until the next modification of StringSet.
+	// Returns the string for an index. The returned pointer is valid for the
+	// lifetime of the StringSet or until it is loaded again.
 	const char* getString(int index) const;
 
 	// Returns whether the set contains a given string.
@@ -43,28 +51,107 @@ public:
 	// Loads the string set from a file.
 	bool loadFromFile(FILE* f);
 
+	// Loads the string set from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+	// Saves the string set to a file together with its hash table. The result starts
+	// with the same data as saveToFile.
+	void saveIndexedToFile(FILE* f);
+
+	// Loads a string set saved with saveIndexedToFile from memory. The hash table is
+	// copied instead of recomputed, unless it is inconsistent with the strings. Fails
+	// if it was built with a different hash function.
+	bool loadIndexedFromMemory(const char* data, size_t size, size_t* pos);
+
+	// The size of the string data, which is also the index of the next added string.
+	int dataSize() const { return m_dataSize; }
+
+	// Appends the data of the strings from index begin to the end to out. Allows to
+	// save a growing string set a part at a time.
+	void appendData(int begin, std::vector<char>* out) const;
+
 	// The number of entries in the string set.
-	int numEntries() const { return m_hashTableLoad; }
+	int numEntries() const { return __atomic_load_n(&m_hashTableLoad, __ATOMIC_ACQUIRE); }
 
 private:
+	// A hash table entry. The hash is kept so that probes and rehashing rarely
+	// need to touch the string data.
+	struct Slot {
+		int m_index;
+		int m_length;
+		unsigned int m_hash;
+	};
+
+	// A hash table is never resized in place. A larger table replaces it, so that
+	// readers can keep probing the old one.
+	struct HashTable {
+		explicit HashTable(size_t capacity);
+		~HashTable();
+
+		size_t m_capacity;
+		// One control byte per slot: EMPTY or the low 7 bits of the slot hash.
+		unsigned char* m_control;
+		Slot* m_slots;
+	};
+
+	// Holds the strings with indices from m_begin up to the m_begin of the next chunk.
+	struct Chunk {
+		char* m_data;
+		int m_begin;
+		int m_capacity;
+	};
+
 	// Returns the index of the added string.
 	int addStringL(const char* s, int slen);
 
 	// Returns the index of a string if exists or -1 otherwise.
-	int findStringL(const char* s, int slen, int hash) const;
+	int findStringL(const char* s, int slen, unsigned int hash) const;
 
 	// Computes hashcode for a string.
-	int stringHash(const char* s, int slen) const;
+	static unsigned int stringHash(const char* s, int slen);
 
 	// Adds a value to the hashtable.
-	void addHash(int hash, int value);
-	void addHashNoRehash(int hash, int value);
+	void addHash(unsigned int hash, int value, int slen);
+	static void addHashNoRehash(HashTable* table, unsigned int hash, int value, int slen);
+
+	// Replaces the hash table with one of the given number of slots, a power of two
+	// and a multiple of GROUP_SIZE.
+	void resizeHashTable(size_t capacity);
 
 	void rehashAll();
 
-	std::vector<char> m_data;
-	std::vector<int> m_hashes;
+	// Returns space for a string of length slen at index m_dataSize.
+	char* allocateString(int slen);
+
+	// Removes all strings and replaces them with the given data.
+	void assignData(const char* data, int size);
+
+	// Frees all chunks and hash tables.
+	void clear();
+
+	// Identifies stringHash and the table layout in saved hash tables. Must change
+	// when any of them changes.
+	static const int HASH_FUNCTION_ID = 2;
+
+	// The control bytes are probed in groups of this many slots.
+	static const int GROUP_SIZE = 16;
+
+	// A new chunk is at least half as large as all previous chunks together, so the
+	// number of chunks stays logarithmic in the data size.
+	static const int MIN_CHUNK_SIZE = 64 * 1024;
+	static const int MAX_CHUNKS = 128;
+
+	Chunk m_chunks[MAX_CHUNKS];
+	int m_numChunks;
+	int m_dataSize;
+
+	HashTable* m_table;
+	// Replaced hash tables. Kept until clear(), since readers may still use them.
+	std::vector<HashTable*> m_oldTables;
 	int m_hashTableLoad;
+
+	StringSet(const StringSet&);
+	void operator=(const StringSet&);
 };
 
 #endif /* STRINGSET_H_ */
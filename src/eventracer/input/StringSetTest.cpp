@@ -0,0 +1,178 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "StringSet.h"
+#include "thread_pool.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+void expectTrue(bool condition, const char* what) {
+	if (!condition) {
+		fprintf(stderr, "Test failed: %s\n^^^ FAIL ^^^\n", what);
+		throw 0;
+	}
+}
+
+// Returns what saveIndexedToFile writes for a string set.
+std::vector<char> saveIndexed(StringSet* strings) {
+	FILE* f = tmpfile();
+	expectTrue(f != NULL, "tmpfile");
+	strings->saveIndexedToFile(f);
+	std::vector<char> data(ftell(f));
+	rewind(f);
+	expectTrue(fread(data.data(), 1, data.size(), f) == data.size(), "read saved string set");
+	fclose(f);
+	return data;
+}
+
+void testIndexedRoundTrip() {
+	printf("Starting test testIndexedRoundTrip...\n");
+	StringSet strings;
+	char s[32];
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(s, sizeof(s), "string %d", i);
+		strings.addString(s);
+	}
+	std::vector<char> data = saveIndexed(&strings);
+	StringSet loaded;
+	size_t pos = 0;
+	expectTrue(loaded.loadIndexedFromMemory(data.data(), data.size(), &pos), "load indexed");
+	expectTrue(pos == data.size(), "whole string set read");
+	expectTrue(loaded.numEntries() == 1000, "same number of entries");
+	for (int i = 0; i < 1000; ++i) {
+		snprintf(s, sizeof(s), "string %d", i);
+		expectTrue(loaded.findString(s) == strings.findString(s), "same index");
+	}
+}
+
+void testIndexedTableChecked() {
+	printf("Starting test testIndexedTableChecked...\n");
+	StringSet strings;
+	strings.addString("first");
+	int abc = strings.addString("abc");
+	std::vector<char> data = saveIndexed(&strings);
+
+	// The data size, the data, the table capacity, the hash function and the load.
+	size_t header_end = sizeof(int) + strings.dataSize() + 3 * sizeof(int);
+	int capacity;
+	memcpy(&capacity, &data[sizeof(int) + strings.dataSize()], sizeof(int));
+	size_t slots = header_end + capacity;
+	// A slot holds the index, the length and the hash of a string.
+	bool found = false;
+	for (int i = 0; i < capacity; ++i) {
+		int slot[2];
+		memcpy(slot, &data[slots + i * 3 * sizeof(int)], sizeof(slot));
+		if (slot[0] != abc) continue;
+		// Point the slot of "abc" to "bc", which is terminated, but not a whole string.
+		slot[0] += 1;
+		slot[1] -= 1;
+		memcpy(&data[slots + i * 3 * sizeof(int)], slot, sizeof(slot));
+		found = true;
+	}
+	expectTrue(found, "slot of abc saved");
+	StringSet loaded;
+	size_t pos = 0;
+	expectTrue(loaded.loadIndexedFromMemory(data.data(), data.size(), &pos), "load indexed");
+	expectTrue(loaded.findString("abc") == abc, "table with a slot inside a string rebuilt");
+	expectTrue(loaded.numEntries() == 2, "no string added twice");
+
+	// A table of another hash function cannot be skipped.
+	int hash_function_id = 1;
+	memcpy(&data[header_end - 2 * sizeof(int)], &hash_function_id, sizeof(int));
+	pos = 0;
+	expectTrue(!loaded.loadIndexedFromMemory(data.data(), data.size(), &pos), "unknown hash function");
+}
+
+// Looks up the strings a writer has added so far while it adds more.
+class ReaderTask : public ThreadTask {
+public:
+	ReaderTask(StringSet* strings, const std::vector<int>* indices, const int* num_added, unsigned int seed)
+		: m_strings(strings), m_indices(indices), m_numAdded(num_added), m_random(seed),
+		  m_numLookups(0), m_numErrors(0) {}
+
+	virtual void run() {
+		char s[32];
+		for (;;) {
+			// Read the count first, so that the writer's last strings are also looked up
+			// after it has finished.
+			int num_added = __atomic_load_n(m_numAdded, __ATOMIC_ACQUIRE);
+			bool done = num_added == static_cast<int>(m_indices->size());
+			for (int k = 0; k < 64 && num_added > 0; ++k) {
+				m_random = m_random * 1103515245 + 12345;
+				int i = (m_random >> 8) % num_added;
+				snprintf(s, sizeof(s), "string %d", i);
+				int index = m_strings->findString(s);
+				if (index != (*m_indices)[i] || strcmp(m_strings->getString(index), s) != 0) ++m_numErrors;
+				snprintf(s, sizeof(s), "missing %d", i);
+				if (m_strings->containsString(s)) ++m_numErrors;
+				if (m_strings->numEntries() < num_added) ++m_numErrors;
+				m_numLookups += 3;
+			}
+			if (done) break;
+		}
+	}
+
+	int numLookups() const { return m_numLookups; }
+	int numErrors() const { return m_numErrors; }
+
+private:
+	StringSet* m_strings;
+	const std::vector<int>* m_indices;
+	const int* m_numAdded;
+	unsigned int m_random;
+	int m_numLookups;
+	int m_numErrors;
+};
+
+void testConcurrentReaders() {
+	printf("Starting test testConcurrentReaders...\n");
+	// Enough strings for several chunks and many hash table resizes.
+	const int num_strings = 200000;
+	StringSet strings;
+	std::vector<int> indices(num_strings);
+	int num_added = 0;
+	ThreadPool pool(4);
+	std::vector<ReaderTask*> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.push_back(new ReaderTask(&strings, &indices, &num_added, t + 1));
+		pool.add(readers.back());
+	}
+	char s[32];
+	for (int i = 0; i < num_strings; ++i) {
+		snprintf(s, sizeof(s), "string %d", i);
+		indices[i] = strings.addString(s);
+		__atomic_store_n(&num_added, i + 1, __ATOMIC_RELEASE);
+	}
+	pool.wait();
+	int num_lookups = 0;
+	for (size_t t = 0; t < readers.size(); ++t) {
+		expectTrue(readers[t]->numErrors() == 0, "lookups during addString");
+		num_lookups += readers[t]->numLookups();
+		delete readers[t];
+	}
+	printf("%d lookups during %d additions\n", num_lookups, num_strings);
+}
+
+int main(void) {
+	testIndexedRoundTrip();
+	testIndexedTableChecked();
+	testConcurrentReaders();
+	printf("All tests passed.\n");
+	return 0;
+}
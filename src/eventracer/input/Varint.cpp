@@ -0,0 +1,178 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "Varint.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define VARINT_HAS_SSSE3 1
+#endif
+
+namespace {
+
+// For every control byte: the total length of the four values and the shuffle
+// that moves their bytes into four 32-bit lanes.
+struct StreamVByteTables {
+	StreamVByteTables() {
+		for (int control = 0; control < 256; ++control) {
+			int pos = 0;
+			for (int i = 0; i < 4; ++i) {
+				int len = ((control >> (2 * i)) & 3) + 1;
+				for (int b = 0; b < 4; ++b) {
+					m_shuffle[control][4 * i + b] = b < len ? pos + b : 0x80;
+				}
+				pos += len;
+			}
+			m_length[control] = pos;
+		}
+	}
+
+	unsigned char m_length[256];
+	unsigned char m_shuffle[256][16];
+};
+
+const StreamVByteTables g_tables;
+
+int ValueLength(unsigned int value) {
+	if (value < (1U << 8)) return 1;
+	if (value < (1U << 16)) return 2;
+	if (value < (1U << 24)) return 3;
+	return 4;
+}
+
+// Returns the number of data bytes of n values with the given control bytes.
+size_t DataSize(const unsigned char* control, size_t n) {
+	size_t data_size = 0;
+	for (size_t i = 0; i < n / 4; ++i) {
+		data_size += g_tables.m_length[control[i]];
+	}
+	for (size_t i = n / 4 * 4; i < n; ++i) {
+		data_size += ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+	}
+	return data_size;
+}
+
+// Decodes the values of the given control bytes one at a time. Returns the position after the data.
+const unsigned char* DecodeScalar(const unsigned char* control, const unsigned char* data,
+		size_t begin, size_t end, unsigned int* values) {
+	for (size_t i = begin; i < end; ++i) {
+		int len = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+		unsigned int value = 0;
+		for (int b = 0; b < len; ++b) {
+			value |= static_cast<unsigned int>(data[b]) << (8 * b);
+		}
+		values[i] = value;
+		data += len;
+	}
+	return data;
+}
+
+#ifdef VARINT_HAS_SSSE3
+// Decodes groups of four values while 16 bytes can be loaded. The last group may be
+// incomplete, then the values after n are garbage. Returns the number of decoded values.
+__attribute__((target("ssse3")))
+size_t DecodeSSSE3(const unsigned char* control, const unsigned char** data, const unsigned char* data_end,
+		size_t n, unsigned int* values) {
+	const unsigned char* p = *data;
+	size_t i = 0;
+	for (; i < n && data_end - p >= 16; i += 4) {
+		unsigned char c = control[i / 4];
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g_tables.m_shuffle[c]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), _mm_shuffle_epi8(bytes, shuffle));
+		p += g_tables.m_length[c];
+	}
+	*data = p;
+	return i;
+}
+
+bool HasSSSE3() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+const bool g_hasSSSE3 = HasSSSE3();
+#endif
+
+}  // namespace
+
+void AppendVarint(unsigned int value, std::vector<unsigned char>* out) {
+	while (value >= 0x80) {
+		out->push_back(static_cast<unsigned char>(value | 0x80));
+		value >>= 7;
+	}
+	out->push_back(static_cast<unsigned char>(value));
+}
+
+bool ReadMultiByteVarint(const unsigned char* data, size_t size, size_t* pos, unsigned int* value) {
+	unsigned int result = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		if (*pos >= size) return false;
+		unsigned char b = data[(*pos)++];
+		result |= static_cast<unsigned int>(b & 0x7f) << shift;
+		if ((b & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+void AppendStreamVByte(const unsigned int* values, size_t n, std::vector<unsigned char>* out) {
+	size_t control_pos = out->size();
+	out->resize(control_pos + (n + 3) / 4, 0);
+	for (size_t i = 0; i < n; ++i) {
+		int len = ValueLength(values[i]);
+		(*out)[control_pos + i / 4] |= (len - 1) << (2 * (i % 4));
+		for (int b = 0; b < len; ++b) {
+			out->push_back(static_cast<unsigned char>(values[i] >> (8 * b)));
+		}
+	}
+}
+
+bool ReadStreamVByte(const unsigned char* data, size_t size, size_t* pos, size_t n, unsigned int* values) {
+	size_t control_size = (n + 3) / 4;
+	if (size - *pos < control_size) return false;
+	const unsigned char* control = data + *pos;
+	const unsigned char* p = control + control_size;
+	const unsigned char* end = data + size;
+	// Check the total length first, so that the decoders do not need to.
+	size_t data_size = DataSize(control, n);
+	if (static_cast<size_t>(end - p) < data_size) return false;
+
+	size_t decoded = 0;
+#ifdef VARINT_HAS_SSSE3
+	if (g_hasSSSE3) {
+		decoded = DecodeSSSE3(control, &p, end, n, values);
+	}
+#endif
+	if (decoded < n) {
+		DecodeScalar(control, p, decoded, n, values);
+	}
+	*pos += control_size + data_size;
+	return true;
+}
+
+bool SkipStreamVByte(const unsigned char* data, size_t size, size_t* pos, size_t n) {
+	size_t control_size = (n + 3) / 4;
+	if (size - *pos < control_size) return false;
+	size_t data_size = DataSize(data + *pos, n);
+	if (size - *pos - control_size < data_size) return false;
+	*pos += control_size + data_size;
+	return true;
+}
@@ -0,0 +1,68 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef VARINT_H_
+#define VARINT_H_
+
+#include <stddef.h>
+#include <vector>
+
+// Maps signed integers to unsigned ones so that values close to zero get small codes.
+inline unsigned int ZigZagEncode(int value) {
+	return (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31);
+}
+inline int ZigZagDecode(unsigned int value) {
+	return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+}
+
+// Encodes the difference of value from base. The difference wraps around instead of
+// overflowing, so that any two values can be encoded.
+inline unsigned int ZigZagEncodeDelta(int value, int base) {
+	return ZigZagEncode(static_cast<int>(static_cast<unsigned int>(value) - static_cast<unsigned int>(base)));
+}
+inline int ZigZagDecodeDelta(unsigned int delta, int base) {
+	return static_cast<int>(static_cast<unsigned int>(base) + static_cast<unsigned int>(ZigZagDecode(delta)));
+}
+
+// Appends a LEB128 varint (7 bits per byte).
+void AppendVarint(unsigned int value, std::vector<unsigned char>* out);
+
+// Reads a LEB128 varint at data[*pos] and advances *pos. Returns false if the data is invalid.
+bool ReadMultiByteVarint(const unsigned char* data, size_t size, size_t* pos, unsigned int* value);
+inline bool ReadVarint(const unsigned char* data, size_t size, size_t* pos, unsigned int* value) {
+	// Most values fit in one byte.
+	if (*pos < size && data[*pos] < 0x80) {
+		*value = data[(*pos)++];
+		return true;
+	}
+	return ReadMultiByteVarint(data, size, pos, value);
+}
+
+// Appends n values in the Stream VByte format: first two bits per value with its
+// length in bytes (packed four per control byte), then the value bytes.
+void AppendStreamVByte(const unsigned int* values, size_t n, std::vector<unsigned char>* out);
+
+// Reads n values in the Stream VByte format at data[*pos] and advances *pos. Uses SSSE3
+// when the CPU supports it, in which case up to three values after the first n may be
+// overwritten, so values must have space for n rounded up to a multiple of four.
+// Returns false if the data is invalid.
+bool ReadStreamVByte(const unsigned char* data, size_t size, size_t* pos, size_t n, unsigned int* values);
+
+// Advances *pos past n values in the Stream VByte format without decoding them.
+// Returns false if the data is invalid.
+bool SkipStreamVByte(const unsigned char* data, size_t size, size_t* pos, size_t n);
+
+#endif /* VARINT_H_ */
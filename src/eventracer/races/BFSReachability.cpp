@@ -0,0 +1,135 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "BFSReachability.h"
+
+
+BFSReachability::BFSReachability() : m_topological(true) {
+}
+
+void BFSReachability::build(const DirectedGraphInterface& graph) {
+	m_graph.build(graph);
+	findTopological();
+}
+
+void BFSReachability::findTopological() {
+	m_topological = true;
+	for (int i = 0; i < m_graph.numNodes() && m_topological; ++i) {
+		NodeSpan successors = m_graph.successors(i);
+		for (size_t j = 0; j < successors.size(); ++j) {
+			if (successors[j] <= i) m_topological = false;
+		}
+	}
+}
+
+bool BFSReachability::areOrdered(int source, int target) const {
+	if (source == target) return true;
+	// A path only passes through nodes before the target.
+	if (source > target || source < 0 || target >= m_graph.numNodes()) return false;
+
+	unsigned int hash = static_cast<unsigned int>(source) * 0x9e3779b1U ^ static_cast<unsigned int>(target) * 0x85ebca6bU;
+	hash ^= hash >> 15;
+	CacheShard& shard = m_cache[hash % NUM_CACHE_SHARDS];
+	size_t slot = (hash / NUM_CACHE_SHARDS) % CACHE_ENTRIES_PER_SHARD;
+	{
+		lock_guard<mutex> lock(shard.m_mutex);
+		const CacheEntry& entry = shard.m_entries[slot];
+		if (entry.m_source == source && entry.m_target == target) {
+			++shard.m_hits;
+			return entry.m_ordered;
+		}
+		++shard.m_misses;
+	}
+
+	bool ordered;
+	int traversal = 0;
+	while (traversal < NUM_TRAVERSALS && !m_forward[traversal].tryAcquire()) ++traversal;
+	if (traversal < NUM_TRAVERSALS) {
+		ordered = search(source, target, &m_forward[traversal], &m_backward[traversal]);
+		m_forward[traversal].release();
+	} else {
+		TraversalContext forward, backward;
+		ordered = search(source, target, &forward, &backward);
+	}
+
+	lock_guard<mutex> lock(shard.m_mutex);
+	CacheEntry& entry = shard.m_entries[slot];
+	entry.m_source = source;
+	entry.m_target = target;
+	entry.m_ordered = ordered;
+	return ordered;
+}
+
+bool BFSReachability::search(int source, int target, TraversalContext* forward, TraversalContext* backward) const {
+	forward->reset(m_graph.numNodes());
+	backward->reset(m_graph.numNodes());
+	forward->visit(source);
+	forward->m_next.push_back(source);
+	backward->visit(target);
+	backward->m_next.push_back(target);
+	for (;;) {
+		bool found;
+		if (forward->m_next.size() <= backward->m_next.size()) {
+			found = expand(true, source, target, forward, *backward);
+		} else {
+			found = expand(false, source, target, backward, *forward);
+		}
+		if (found) return true;
+		if (forward->m_next.empty() || backward->m_next.empty()) return false;
+	}
+}
+
+bool BFSReachability::expand(bool forward_search, int source, int target,
+		TraversalContext* search, const TraversalContext& other) const {
+	std::vector<int>& current = search->m_current;
+	std::vector<int>& next = search->m_next;
+	current.swap(next);
+	next.clear();
+	for (size_t i = 0; i < current.size(); ++i) {
+		NodeSpan followers = forward_search ? m_graph.successors(current[i]) : m_graph.predecessors(current[i]);
+		for (size_t j = 0; j < followers.size(); ++j) {
+			int node = followers[j];
+			// Nodes after the target are not on a path to it. If the ids are a topological
+			// order, neither are the nodes before the source.
+			if (node > target || (m_topological && node < source)) continue;
+			if (other.isVisited(node)) return true;
+			if (search->visit(node)) next.push_back(node);
+		}
+	}
+	return false;
+}
+
+void BFSReachability::printStats() const {
+	int64 hits = 0, misses = 0;
+	for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+		lock_guard<mutex> lock(m_cache[i].m_mutex);
+		hits += m_cache[i].m_hits;
+		misses += m_cache[i].m_misses;
+	}
+	int64 queries = hits + misses;
+	printf("BFSReachability: %lld queries, %.1f%% answered from the cache\n",
+			queries, queries == 0 ? 0.0 : hits * 100.0 / queries);
+}
+
+void BFSReachability::saveToFile(FILE* f) const {
+	m_graph.saveToFile(f);
+}
+
+bool BFSReachability::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!m_graph.loadFromMemory(data, size, pos)) return false;
+	findTopological();
+	return true;
+}
@@ -0,0 +1,103 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef BFSREACHABILITY_H_
+#define BFSREACHABILITY_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#include "base.h"
+#include "EventGraph.h"
+#include "FrozenGraph.h"
+#include "mutex.h"
+
+// Computes happens before by searching the event graph. Needs no memory beyond the
+// graph, so it works for graphs too large for vector clocks, but every query is a
+// search. Like SimpleDirectedGraph::areOrdered, a path to a node may only pass
+// through nodes with lower ids.
+//
+// A query searches forward from the earlier node and backward from the later one,
+// each time extending the smaller frontier. If the node ids are a topological order
+// of the graph, only the nodes between the two are visited.
+// The recent answers are kept in a cache, split into shards with a lock each so
+// that queries from several threads rarely wait for each other.
+class BFSReachability : public EventGraphInterface {
+public:
+	BFSReachability();
+
+	void build(const DirectedGraphInterface& graph);
+
+	virtual bool areOrdered(int source, int target) const;
+
+	// Prints the number of queries and the cache hit rate.
+	void printStats() const;
+
+	// Saves the graph to a file. The cache is not saved.
+	void saveToFile(FILE* f) const;
+
+	// Loads the graph from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+private:
+	enum {
+		NUM_CACHE_SHARDS = 16,
+		CACHE_ENTRIES_PER_SHARD = 1 << 14,
+		// Number of searches that can run concurrently without allocating.
+		NUM_TRAVERSALS = 4
+	};
+
+	struct CacheEntry {
+		CacheEntry() : m_source(-1), m_target(-1), m_ordered(false) {}
+
+		int m_source;
+		int m_target;
+		bool m_ordered;
+	};
+
+	// A direct mapped part of the cache: a query can only be in one entry, which
+	// keeps the last query that mapped to it.
+	struct CacheShard {
+		CacheShard() : m_entries(CACHE_ENTRIES_PER_SHARD), m_hits(0), m_misses(0) {}
+
+		mutex m_mutex;
+		std::vector<CacheEntry> m_entries;
+		int64 m_hits;
+		int64 m_misses;
+	};
+
+	void findTopological();
+	bool search(int source, int target, TraversalContext* forward, TraversalContext* backward) const;
+	// Adds the followers of the frontier of a search that can be on a path from source
+	// to target to its next frontier. Returns true if one was visited by the other search.
+	bool expand(bool forward_search, int source, int target,
+			TraversalContext* search, const TraversalContext& other) const;
+
+	FrozenGraph m_graph;
+	// Whether every arc goes to a node with a higher id.
+	bool m_topological;
+
+	mutable CacheShard m_cache[NUM_CACHE_SHARDS];
+	mutable TraversalContext m_forward[NUM_TRAVERSALS];
+	mutable TraversalContext m_backward[NUM_TRAVERSALS];
+
+	// Deleted.
+	BFSReachability(const BFSReachability&);
+	BFSReachability& operator=(const BFSReachability&);
+};
+
+#endif /* BFSREACHABILITY_H_ */
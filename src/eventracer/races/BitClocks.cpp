@@ -17,49 +17,396 @@
 #include "BitClocks.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <immintrin.h>
 
 #include "base.h"
+#include "serialize.h"
+#include "thread_pool.h"
+
+
+namespace {
+
+typedef void (*OrRowFunction)(unsigned int* out, const unsigned int* in, size_t size);
+
+void OrRowSse2(unsigned int* out, const unsigned int* in, size_t size) {
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_or_si128(a, b));
+	}
+	for (; i < size; ++i) {
+		out[i] |= in[i];
+	}
+}
+
+__attribute__((target("avx2")))
+void OrRowAvx2(unsigned int* out, const unsigned int* in, size_t size) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_or_si256(a, b));
+	}
+	for (; i < size; ++i) {
+		out[i] |= in[i];
+	}
+}
+
+__attribute__((target("avx512f")))
+void OrRowAvx512(unsigned int* out, const unsigned int* in, size_t size) {
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m512i a = _mm512_loadu_si512(out + i);
+		__m512i b = _mm512_loadu_si512(in + i);
+		_mm512_storeu_si512(out + i, _mm512_or_si512(a, b));
+	}
+	for (; i < size; ++i) {
+		out[i] |= in[i];
+	}
+}
+
+// Picks the widest vector instructions the processor has.
+OrRowFunction SelectOrRow() {
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return OrRowAvx512;
+	if (__builtin_cpu_supports("avx2")) return OrRowAvx2;
+	return OrRowSse2;
+}
+
+OrRowFunction OrRow = SelectOrRow();
+
+// Levels with fewer nodes are computed on the calling thread.
+const int kMinParallelLevelSize = 64;
+// Number of nodes a thread takes at a time.
+const int kNodesPerStep = 8;
 
+}  // namespace
+
+// Computes the clocks of the nodes of a level. The threads take the next nodes from
+// a shared counter, so a thread that finishes early takes over the remaining nodes.
+class BitClocks::LevelTask : public ThreadTask {
+public:
+	LevelTask(BitClocks* clocks, const DirectedGraphInterface& graph)
+		: m_clocks(clocks), m_graph(graph), m_nodes(NULL), m_numNodes(0), m_next(NULL) {
+	}
+
+	void setLevel(const int* nodes, int num_nodes, volatile int* next) {
+		m_nodes = nodes;
+		m_numNodes = num_nodes;
+		m_next = next;
+	}
+
+	virtual void run() {
+		for (;;) {
+			int begin = __sync_fetch_and_add(m_next, kNodesPerStep);
+			if (begin >= m_numNodes) break;
+			int end = std::min(begin + kNodesPerStep, m_numNodes);
+			for (int i = begin; i < end; ++i) {
+				m_clocks->computeBitClock(m_graph, m_nodes[i], &m_buffer);
+			}
+		}
+	}
+
+private:
+	BitClocks* m_clocks;
+	const DirectedGraphInterface& m_graph;
+	const int* m_nodes;
+	int m_numNodes;
+	volatile int* m_next;
+	std::vector<unsigned int> m_buffer;
+};
 
 BitClocks::BitClocks() {
 }
 
-void BitClocks::build(const SimpleDirectedGraph& graph) {
+bool BitClocks::setOrRowInstructions(const char* name) {
+	__builtin_cpu_init();
+	if (strcmp(name, "avx512f") == 0) {
+		if (!__builtin_cpu_supports("avx512f")) return false;
+		OrRow = OrRowAvx512;
+	} else if (strcmp(name, "avx2") == 0) {
+		if (!__builtin_cpu_supports("avx2")) return false;
+		OrRow = OrRowAvx2;
+	} else if (strcmp(name, "sse2") == 0) {
+		OrRow = OrRowSse2;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void BitClocks::build(const DirectedGraphInterface& graph, ThreadPool* pool,
+		const std::vector<int>* columns) {
 	int nodes = graph.numNodes();
-	std::vector<unsigned int> empty((nodes + 31) / 32, 0);
-	m_bitClocks.assign(nodes, empty);
-	computeBitClocks(graph);
+	m_successorsBegin.assign(1, 0);
+	m_successors.clear();
+	for (int i = 0; i < nodes; ++i) {
+		NodeSpan successors = graph.successors(i);
+		for (size_t j = 0; j < successors.size(); ++j) {
+			if (successors[j] > i) m_successors.push_back(successors[j]);
+		}
+		m_successorsBegin.push_back(m_successors.size());
+	}
+	m_column.assign(nodes, -1);
+	m_numColumnsUpTo.assign(nodes, 0);
+	int num_columns = 0;
+	for (int i = 0; i < nodes; ++i) {
+		if (columns == NULL || std::binary_search(columns->begin(), columns->end(), i)) {
+			m_column[i] = num_columns++;
+		}
+		m_numColumnsUpTo[i] = num_columns;
+	}
+
+	m_onesBegin.assign(nodes, 0);
+	m_onesEnd.assign(nodes, 0);
+	m_words.assign(nodes, std::vector<unsigned int>());
+	m_wordPositions.assign(nodes, std::vector<int>());
+	computeBitClocks(graph, pool);
+	std::vector<int>().swap(m_numColumnsUpTo);
 }
 
-void BitClocks::computeBitClocks(const SimpleDirectedGraph& graph) {
+void BitClocks::computeBitClocks(const DirectedGraphInterface& graph, ThreadPool* pool) {
 	printf("Computing BitClocks...\n");
 	int64 start_time = GetCurrentTimeMicros();
 
-	for (int node_id = 0; node_id < graph.numNodes(); ++node_id) {
-		std::vector<unsigned int>& cl = m_bitClocks[node_id];
+	int num_nodes = graph.numNodes();
+	int num_threads = pool != NULL ? pool->numThreads() : 1;
+	std::vector<unsigned int> buffer;
+	if (num_threads <= 1) {
+		for (int node_id = 0; node_id < num_nodes; ++node_id) {
+			computeBitClock(graph, node_id, &buffer);
+		}
+	} else {
+		// Sort the nodes by level. The predecessors of a node have lower levels.
+		std::vector<int> levels(num_nodes, 0);
+		int num_levels = 0;
+		for (int node_id = 0; node_id < num_nodes; ++node_id) {
+			NodeSpan pred = graph.predecessors(node_id);
+			for (size_t j = 0; j < pred.size(); ++j) {
+				if (pred[j] < node_id) levels[node_id] = std::max(levels[node_id], levels[pred[j]] + 1);
+			}
+			num_levels = std::max(num_levels, levels[node_id] + 1);
+		}
+		std::vector<int> level_begin(num_levels + 1, 0);
+		for (int node_id = 0; node_id < num_nodes; ++node_id) {
+			++level_begin[levels[node_id] + 1];
+		}
+		for (int level = 0; level < num_levels; ++level) {
+			level_begin[level + 1] += level_begin[level];
+		}
+		std::vector<int> sorted(num_nodes);
+		std::vector<int> position(level_begin.begin(), level_begin.end() - 1);
+		for (int node_id = 0; node_id < num_nodes; ++node_id) {
+			sorted[position[levels[node_id]]++] = node_id;
+		}
 
-		const std::vector<int>& pred = graph.nodePredecessors(node_id);
-		for (size_t j = 0; j < pred.size(); ++j) {
-			for (size_t i = 0; i < cl.size(); ++i) {
-				cl[i] |= m_bitClocks[pred[j]][i];
+		std::vector<LevelTask*> tasks;
+		for (int i = 0; i < num_threads; ++i) {
+			tasks.push_back(new LevelTask(this, graph));
+		}
+		for (int level = 0; level < num_levels; ++level) {
+			const int* nodes = sorted.data() + level_begin[level];
+			int level_size = level_begin[level + 1] - level_begin[level];
+			if (level_size < kMinParallelLevelSize) {
+				for (int i = 0; i < level_size; ++i) {
+					computeBitClock(graph, nodes[i], &buffer);
+				}
+				continue;
 			}
+			volatile int next = 0;
+			for (int i = 0; i < num_threads; ++i) {
+				tasks[i]->setLevel(nodes, level_size, &next);
+				pool->add(tasks[i]);
+			}
+			pool->wait();
+		}
+		for (int i = 0; i < num_threads; ++i) {
+			delete tasks[i];
+		}
+	}
+	int num_columns = num_nodes == 0 ? 0 : m_numColumnsUpTo[num_nodes - 1];
+	printf("Computing BitClocks done... (%lld ms, %d columns, %lld KB, %lld KB uncompressed)\n",
+			(GetCurrentTimeMicros() - start_time) / 1000, num_columns, clocksSizeBytes() / 1024,
+			static_cast<int64>(num_nodes) * ((num_columns + 31) / 32) * sizeof(unsigned int) / 1024);
+}
+
+void BitClocks::computeBitClock(const DirectedGraphInterface& graph, int node_id,
+		std::vector<unsigned int>* buffer) {
+	// The clock has no bits for the columns of later nodes.
+	int num_words = m_numColumnsUpTo[node_id] / 32 + 1;
+	buffer->assign(num_words, 0);
+	unsigned int* cl = buffer->data();
+
+	NodeSpan pred = graph.predecessors(node_id);
+	for (size_t j = 0; j < pred.size(); ++j) {
+		// The clocks of later nodes are not computed yet.
+		if (pred[j] > node_id) continue;
+		orBitClock(pred[j], cl);
+	}
+	int column = m_column[node_id];
+	if (column != -1) cl[column / 32] |= 1u << (column % 32);
+
+	int end = num_words;
+	while (end > 0 && cl[end - 1] == 0) --end;
+	int ones_begin = 0, ones_end = 0;
+	for (int i = 0; i < end; ) {
+		if (cl[i] != ~0u) {
+			++i;
+			continue;
+		}
+		int run_begin = i;
+		while (i < end && cl[i] == ~0u) ++i;
+		if (i - run_begin > ones_end - ones_begin) {
+			ones_begin = run_begin;
+			ones_end = i;
 		}
-		cl[node_id / 32] |= 1u << (node_id % 32);
 	}
-	printf("Computing BitClocks done... (%lld ms)\n", (GetCurrentTimeMicros() - start_time) / 1000);
+	int num_nonzero = 0;
+	for (int i = 0; i < end; ++i) {
+		if (cl[i] != 0) ++num_nonzero;
+	}
+	num_nonzero -= ones_end - ones_begin;
+	m_onesBegin[node_id] = ones_begin;
+	m_onesEnd[node_id] = ones_end;
+	std::vector<unsigned int>& words = m_words[node_id];
+	std::vector<int>& positions = m_wordPositions[node_id];
+	// A sparse word takes twice the space of a dense one.
+	if (num_nonzero * 2 < end - (ones_end - ones_begin)) {
+		words.reserve(num_nonzero);
+		positions.reserve(num_nonzero);
+		for (int i = 0; i < end; ++i) {
+			if (cl[i] == 0 || (i >= ones_begin && i < ones_end)) continue;
+			words.push_back(cl[i]);
+			positions.push_back(i);
+		}
+	} else {
+		words.reserve(end - (ones_end - ones_begin));
+		words.assign(cl, cl + ones_begin);
+		words.insert(words.end(), cl + ones_end, cl + end);
+	}
+}
+
+void BitClocks::orBitClock(int node_id, unsigned int* buffer) const {
+	int ones_begin = m_onesBegin[node_id];
+	int ones_end = m_onesEnd[node_id];
+	memset(buffer + ones_begin, 0xff, (ones_end - ones_begin) * sizeof(unsigned int));
+	const std::vector<unsigned int>& words = m_words[node_id];
+	const std::vector<int>& positions = m_wordPositions[node_id];
+	if (positions.empty()) {
+		size_t num_before = std::min(words.size(), static_cast<size_t>(ones_begin));
+		OrRow(buffer, words.data(), num_before);
+		OrRow(buffer + ones_end, words.data() + num_before, words.size() - num_before);
+	} else {
+		for (size_t i = 0; i < positions.size(); ++i) {
+			buffer[positions[i]] |= words[i];
+		}
+	}
+}
+
+bool BitClocks::hasBit(int node_id, int bit) const {
+	int word = bit / 32;
+	int ones_begin = m_onesBegin[node_id];
+	int ones_end = m_onesEnd[node_id];
+	if (word >= ones_begin && word < ones_end) return true;
+	const std::vector<unsigned int>& words = m_words[node_id];
+	const std::vector<int>& positions = m_wordPositions[node_id];
+	if (positions.empty()) {
+		size_t i = word < ones_begin ? word : word - (ones_end - ones_begin);
+		return i < words.size() && ((words[i] >> (bit % 32)) & 1) != 0;
+	}
+	std::vector<int>::const_iterator it = std::lower_bound(positions.begin(), positions.end(), word);
+	if (it == positions.end() || *it != word) return false;
+	return ((words[it - positions.begin()] >> (bit % 32)) & 1) != 0;
+}
+
+int64 BitClocks::clocksSizeBytes() const {
+	int64 num_words = 0;
+	for (size_t node_id = 0; node_id < m_words.size(); ++node_id) {
+		num_words += m_words[node_id].size() + m_wordPositions[node_id].size();
+	}
+	return num_words * sizeof(unsigned int);
 }
 
 bool BitClocks::areOrdered(int slice1, int slice2) const {
 	if (slice1 < 0 ||
 		slice2 < 0 ||
-		slice1 >= static_cast<int>(m_bitClocks.size()) ||
-		slice2 >= static_cast<int>(m_bitClocks.size())) return false;
+		slice1 >= static_cast<int>(m_onesBegin.size()) ||
+		slice2 >= static_cast<int>(m_onesBegin.size())) return false;
 
 	if (slice1 == slice2) return true;
+	if (slice1 > slice2) return false;
 
-	int a1 = (m_bitClocks[slice1][slice1 / 32] >> (slice1 % 32)) & 1;
-	int a2 = (m_bitClocks[slice2][slice1 / 32] >> (slice1 % 32)) & 1;
-	return a1 <= a2;
+	// A node is in its own clock, so slice1 happens before slice2 if it is in its clock.
+	if (m_column[slice1] != -1) return hasBit(slice2, m_column[slice1]);
+
+	for (int i = 0; i < NUM_TRAVERSALS; ++i) {
+		if (!m_traversals[i].tryAcquire()) continue;
+		bool ordered = search(slice1, slice2, &m_traversals[i]);
+		m_traversals[i].release();
+		return ordered;
+	}
+	TraversalContext context;
+	return search(slice1, slice2, &context);
 }
 
+bool BitClocks::search(int source, int target, TraversalContext* context) const {
+	context->reset(m_column.size());
+	std::vector<int>& stack = context->m_next;
+	stack.clear();
+	context->visit(source);
+	stack.push_back(source);
+	while (!stack.empty()) {
+		int node = stack.back();
+		stack.pop_back();
+		for (int j = m_successorsBegin[node]; j < m_successorsBegin[node + 1]; ++j) {
+			int successor = m_successors[j];
+			if (successor == target) return true;
+			if (successor > target || !context->visit(successor)) continue;
+			// The clock of the target tells if a node with a column reaches it, and then
+			// so do all nodes it reaches.
+			if (m_column[successor] != -1) {
+				if (hasBit(target, m_column[successor])) return true;
+				continue;
+			}
+			stack.push_back(successor);
+		}
+	}
+	return false;
+}
 
+void BitClocks::saveToFile(FILE* f) const {
+	WriteVector(f, m_successorsBegin);
+	WriteVector(f, m_successors);
+	WriteVector(f, m_column);
+	WriteVector(f, m_onesBegin);
+	WriteVector(f, m_onesEnd);
+	WriteVectors(f, m_words);
+	WriteVectors(f, m_wordPositions);
+}
+
+bool BitClocks::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadVector(data, size, pos, &m_successorsBegin) ||
+			!ReadVector(data, size, pos, &m_successors) ||
+			!ReadVector(data, size, pos, &m_column) ||
+			!ReadVector(data, size, pos, &m_onesBegin) ||
+			!ReadVector(data, size, pos, &m_onesEnd) ||
+			!ReadVectors(data, size, pos, &m_words) ||
+			!ReadVectors(data, size, pos, &m_wordPositions)) return false;
+	size_t num_nodes = m_onesBegin.size();
+	if (m_onesEnd.size() != num_nodes || m_words.size() != num_nodes || m_wordPositions.size() != num_nodes ||
+			m_column.size() != num_nodes || m_successorsBegin.size() != num_nodes + 1) return false;
+	for (size_t i = 0; i < num_nodes; ++i) {
+		if (m_onesBegin[i] < 0 || m_onesBegin[i] > m_onesEnd[i]) return false;
+		if (!m_wordPositions[i].empty() && m_wordPositions[i].size() != m_words[i].size()) return false;
+		if (m_successorsBegin[i] < 0 || m_successorsBegin[i] > m_successorsBegin[i + 1]) return false;
+	}
+	if (static_cast<size_t>(m_successorsBegin[num_nodes]) != m_successors.size()) return false;
+	for (size_t i = 0; i < m_successors.size(); ++i) {
+		if (static_cast<size_t>(m_successors[i]) >= num_nodes) return false;
+	}
+	return true;
+}
@@ -17,22 +17,90 @@
 #ifndef BITCLOCKS_H_
 #define BITCLOCKS_H_
 
+#include <stddef.h>
+#include <stdio.h>
 #include <vector>
 #include "EventGraph.h"
+#include "base.h"
+
+class ThreadPool;
 
 // Computes happens before using vector clocks of width |num_nodes|, but with optimized storage for
 // one bit per vector clock value (such vector clocks may have values only of 0 and 1).
+//
+// A clock has no bits after its own node and usually has a long run of ones (the nodes that
+// happen before everything), so it is stored compressed: the longest run of words that are
+// all ones, and the other words up to the last nonzero one. If few of these words are nonzero,
+// only those are stored together with their positions.
+//
+// The clocks can be restricted to some nodes (the columns), e.g. the ones that race
+// detection queries. The clocks are still computed through all nodes, but have one bit per
+// column. A query from a node without a column searches the graph until it reaches nodes
+// with columns.
 class BitClocks : public EventGraphInterface {
 public:
 	BitClocks();
-	void build(const SimpleDirectedGraph& graph);
+	// Computes the clocks. With a pool, the nodes of a level (the longest path to
+	// them) do not depend on each other and are computed in parallel. If columns is
+	// given, it has the sorted ids of the nodes that get a bit, otherwise all do.
+	void build(const DirectedGraphInterface& graph, ThreadPool* pool = NULL,
+			const std::vector<int>* columns = NULL);
 
 	virtual bool areOrdered(int slice1, int slice2) const;
 
+	// Returns the size of the stored words of the clocks.
+	int64 clocksSizeBytes() const;
+
+	// Makes the later builds OR rows with "avx512f", "avx2" or "sse2" instructions
+	// instead of the widest ones the processor has. Returns false if it does not have
+	// them. For tests; must not be called during a build.
+	static bool setOrRowInstructions(const char* name);
+
+	// Saves the bit clocks to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the bit clocks from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
 private:
-	void computeBitClocks(const SimpleDirectedGraph& graph);
+	class LevelTask;
+
+	enum {
+		// Number of searches that can run concurrently without allocating.
+		NUM_TRAVERSALS = 4
+	};
+
+	void computeBitClocks(const DirectedGraphInterface& graph, ThreadPool* pool);
+	// Computes the clock of a node in the uncompressed buffer and stores it compressed.
+	void computeBitClock(const DirectedGraphInterface& graph, int node_id, std::vector<unsigned int>* buffer);
+	// ORs the clock of a node into an uncompressed buffer.
+	void orBitClock(int node_id, unsigned int* buffer) const;
+	bool hasBit(int node_id, int bit) const;
+	// Answers a query from a node without a column.
+	bool search(int source, int target, TraversalContext* context) const;
+
+	// The graph without the arcs to nodes with lower ids, in compressed sparse row format.
+	std::vector<int> m_successorsBegin;
+	std::vector<int> m_successors;
+	// Per node: its bit in the clocks or -1.
+	std::vector<int> m_column;
+	// Per node: the number of columns of the nodes up to it. Only used by the build.
+	std::vector<int> m_numColumnsUpTo;
+
+	// Per node: the longest run of words that are all ones.
+	std::vector<int> m_onesBegin;
+	std::vector<int> m_onesEnd;
+	// Per node: the words before and after the run of ones, up to the last nonzero word.
+	std::vector<std::vector<unsigned int> > m_words;
+	// Per node: empty if all words outside the run of ones are stored. Otherwise only the
+	// nonzero words are stored and this has their positions.
+	std::vector<std::vector<int> > m_wordPositions;
+
+	mutable TraversalContext m_traversals[NUM_TRAVERSALS];
 
-	std::vector<std::vector<unsigned int> > m_bitClocks;
+	// Deleted.
+	BitClocks(const BitClocks&);
+	BitClocks& operator=(const BitClocks&);
 };
 
 #endif /* BITCLOCKS_H_ */
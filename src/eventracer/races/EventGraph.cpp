@@ -16,10 +16,29 @@
 
 #include "EventGraph.h"
 
+#include "serialize.h"
+
 
 EventGraphInterface::~EventGraphInterface() {
 }
 
+DirectedGraphInterface::~DirectedGraphInterface() {
+}
+
+
+void TraversalContext::reset(int num_nodes) {
+	if (m_stamps.size() < static_cast<size_t>(num_nodes)) {
+		m_stamps.resize(num_nodes, 0);
+	}
+	if (++m_generation == 0) {
+		// The generation wrapped around, so old stamps could look current.
+		m_stamps.assign(m_stamps.size(), 0);
+		m_generation = 1;
+	}
+	m_current.clear();
+	m_next.clear();
+}
+
 
 SimpleDirectedGraph::SimpleDirectedGraph() {
 	addNode();  // Node 0 doesn't exist.
@@ -125,6 +144,19 @@ void SimpleDirectedGraph::addShortcutArcIfNeeded(int source, int target) {
 	addArc(source, target);
 }
 
+TraversalContext* SimpleDirectedGraph::acquireTraversal() const {
+	for (int i = 0; i < NUM_TRAVERSALS; ++i) {
+		if (m_traversals[i].tryAcquire()) return &m_traversals[i];
+	}
+	return NULL;
+}
+
+void SimpleDirectedGraph::releaseTraversal(TraversalContext* context) const {
+	for (int i = 0; i < NUM_TRAVERSALS; ++i) {
+		if (context == &m_traversals[i]) context->release();
+	}
+}
+
 void SimpleDirectedGraph::deleteArcFromSuccessors(int source, int target) {
 	Node& node = m_nodes[source];
 	for (size_t i = 0; i < node.m_successors.size(); ++i) {
@@ -144,3 +176,26 @@ void SimpleDirectedGraph::deleteArcFromPredecessors(int source, int target) {
 		}
 	}
 }
+
+void SimpleDirectedGraph::saveToFile(FILE* f) const {
+	WriteValue(f, static_cast<int>(m_nodes.size()));
+	for (size_t i = 0; i < m_nodes.size(); ++i) {
+		WriteValue(f, static_cast<char>(m_nodes[i].m_deleted));
+		WriteVector(f, m_nodes[i].m_predecessors);
+		WriteVector(f, m_nodes[i].m_successors);
+	}
+}
+
+bool SimpleDirectedGraph::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	int num_nodes;
+	if (!ReadValue(data, size, pos, &num_nodes) || num_nodes < 0) return false;
+	m_nodes.assign(num_nodes, Node());
+	for (int i = 0; i < num_nodes; ++i) {
+		char deleted;
+		if (!ReadValue(data, size, pos, &deleted)) return false;
+		m_nodes[i].m_deleted = deleted != 0;
+		if (!ReadVector(data, size, pos, &m_nodes[i].m_predecessors) ||
+				!ReadVector(data, size, pos, &m_nodes[i].m_successors)) return false;
+	}
+	return true;
+}
@@ -18,8 +18,8 @@
 #define EVENTGRAPH_H_
 
 #include <stddef.h>
+#include <stdio.h>
 #include <vector>
-#include <set>
 #include <utility>
 
 class EventGraphInterface {
@@ -28,7 +28,81 @@ public:
 	virtual bool areOrdered(int source, int target) const = 0;
 };
 
-class SimpleDirectedGraph : public EventGraphInterface {
+// A read-only view of the predecessors or successors of a node.
+class NodeSpan {
+public:
+	NodeSpan() : m_nodes(NULL), m_size(0) {}
+	NodeSpan(const int* nodes, size_t size) : m_nodes(nodes), m_size(size) {}
+	explicit NodeSpan(const std::vector<int>& nodes) : m_nodes(nodes.data()), m_size(nodes.size()) {}
+
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	int operator[](size_t i) const { return m_nodes[i]; }
+
+	const int* begin() const { return m_nodes; }
+	const int* end() const { return m_nodes + m_size; }
+
+private:
+	const int* m_nodes;
+	size_t m_size;
+};
+
+// Read-only access to the nodes and arcs of a directed graph. Analyses that do not
+// change the graph take it through this interface, so they can run on a FrozenGraph.
+class DirectedGraphInterface {
+public:
+	virtual ~DirectedGraphInterface();
+
+	virtual int numNodes() const = 0;
+	virtual bool isNodeDeleted(int node_id) const = 0;
+	virtual NodeSpan predecessors(int node_id) const = 0;
+	virtual NodeSpan successors(int node_id) const = 0;
+};
+
+// The state of a breadth first search: the visited nodes and the frontiers. A node is
+// visited if its stamp is the current generation, so starting a new search only
+// increments the generation. The arrays keep their size between searches, so a
+// reused context does not allocate.
+class TraversalContext {
+public:
+	TraversalContext() : m_generation(0), m_inUse(0) {}
+	// Copies start empty, the state of a search is not copied.
+	TraversalContext(const TraversalContext&) : m_generation(0), m_inUse(0) {}
+	TraversalContext& operator=(const TraversalContext&) { return *this; }
+
+	// Starts a new search on a graph with num_nodes nodes.
+	void reset(int num_nodes);
+
+	// Marks a node as visited. Returns false if it was already visited.
+	bool visit(int node_id) {
+		if (static_cast<size_t>(node_id) >= m_stamps.size()) m_stamps.resize(node_id + 1, 0);
+		if (m_stamps[node_id] == m_generation) return false;
+		m_stamps[node_id] = m_generation;
+		return true;
+	}
+
+	bool isVisited(int node_id) const {
+		return static_cast<size_t>(node_id) < m_stamps.size() && m_stamps[node_id] == m_generation;
+	}
+
+	// Claims the context for one search at a time. Returns false if it is in use.
+	bool tryAcquire() { return __sync_lock_test_and_set(&m_inUse, 1) == 0; }
+	void release() { __sync_lock_release(&m_inUse); }
+
+private:
+	friend class SimpleDirectedGraph;
+	friend class BFSReachability;
+	friend class BitClocks;
+	friend class IntervalLabels;
+
+	std::vector<unsigned int> m_stamps;
+	unsigned int m_generation;
+	std::vector<int> m_current;
+	std::vector<int> m_next;
+	volatile int m_inUse;
+};
+
+class SimpleDirectedGraph : public EventGraphInterface, public DirectedGraphInterface {
 public:
 	SimpleDirectedGraph();
 
@@ -42,10 +116,10 @@ public:
 		m_nodes.push_back(Node());
 		return m_nodes.size() - 1;
 	}
-	int numNodes() const {
+	virtual int numNodes() const {
 		return m_nodes.size();
 	}
-	bool isNodeDeleted(int node_id) const {
+	virtual bool isNodeDeleted(int node_id) const {
 		return m_nodes[node_id].m_deleted;
 	}
 	void addArc(int source, int target);
@@ -57,16 +131,43 @@ public:
 	bool areConnected(int source, int target) const;
 	bool hasArc(int source, int target) const;
 
-	// Breadth first iterator
+	// Saves the graph to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the graph from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+	// Breadth first iterator. Uses a traversal context of the graph if one is free,
+	// so repeated searches do not allocate, or the given context.
 	class BFIterator {
 	public:
 		BFIterator(const SimpleDirectedGraph& graph, int max_depth, bool forward)
-		    : m_graph(graph), m_depthRemaining(max_depth), m_forward(forward), m_currentId(0) {
+		    : m_graph(graph), m_depthRemaining(max_depth), m_forward(forward), m_currentId(0),
+		      m_context(graph.acquireTraversal()), m_ownsContext(false) {
+			if (m_context == NULL) {
+				m_context = new TraversalContext();
+				m_ownsContext = true;
+			}
+			m_context->reset(graph.numNodes());
+		}
+
+		BFIterator(const SimpleDirectedGraph& graph, int max_depth, bool forward, TraversalContext* context)
+		    : m_graph(graph), m_depthRemaining(max_depth), m_forward(forward), m_currentId(0),
+		      m_context(context), m_ownsContext(false) {
+			m_context->reset(graph.numNodes());
+		}
+
+		~BFIterator() {
+			if (m_ownsContext) {
+				delete m_context;
+			} else {
+				m_graph.releaseTraversal(m_context);
+			}
 		}
 
 		void addNode(int nodeId) {
-			if (m_depthRemaining > 0 && m_visited.insert(nodeId).second) {
-				m_next.push_back(nodeId);
+			if (m_depthRemaining > 0 && m_context->visit(nodeId)) {
+				m_context->m_next.push_back(nodeId);
 			}
 		}
 
@@ -78,10 +179,10 @@ public:
 		}
 
 		bool readNoAddFollowers(int* nodeId) {
-			if (m_currentId >= m_current.size()) {
+			if (m_currentId >= m_context->m_current.size()) {
 				if (!nextLevel()) return false;
 			}
-			*nodeId = m_current[m_currentId];
+			*nodeId = m_context->m_current[m_currentId];
 			++m_currentId;
 			return true;
 		}
@@ -105,14 +206,14 @@ public:
 		}
 
 		bool isVisited(int nodeId) const {
-			return m_visited.find(nodeId) != m_visited.end();
+			return m_context->isVisited(nodeId);
 		}
 
 	private:
 		bool nextLevel() {
-			if (m_next.empty()) return false;
-			m_current.swap(m_next);
-			m_next.clear();
+			if (m_context->m_next.empty()) return false;
+			m_context->m_current.swap(m_context->m_next);
+			m_context->m_next.clear();
 			m_currentId = 0;
 			--m_depthRemaining;
 			return true;
@@ -122,9 +223,12 @@ public:
 		int m_depthRemaining;
 		bool m_forward;
 		size_t m_currentId;
-		std::vector<int> m_current;
-		std::vector<int> m_next;
-		std::set<int> m_visited;
+		TraversalContext* m_context;
+		bool m_ownsContext;
+
+		// Deleted.
+		BFIterator(const BFIterator&);
+		BFIterator& operator=(const BFIterator&);
 	};
 	friend class BFIterator;
 
@@ -136,11 +240,23 @@ public:
 		return m_nodes[nodeId].m_successors;
 	}
 
+	virtual NodeSpan predecessors(int node_id) const {
+		return NodeSpan(m_nodes[node_id].m_predecessors);
+	}
+	virtual NodeSpan successors(int node_id) const {
+		return NodeSpan(m_nodes[node_id].m_successors);
+	}
+
 private:
 	void deleteArcFromSuccessors(int source, int target);
 	void deleteArcFromPredecessors(int source, int target);
 	void addShortcutArcIfNeeded(int source, int target);
 
+	// Returns a free traversal context of the graph or NULL if all are in use.
+	TraversalContext* acquireTraversal() const;
+	// Releases a context returned by acquireTraversal. Does nothing for other contexts.
+	void releaseTraversal(TraversalContext* context) const;
+
 	struct Node {
 		Node() : m_deleted(false) {
 		}
@@ -151,6 +267,11 @@ private:
 	};
 
 	std::vector<Node> m_nodes;
+
+	// Traversal contexts for BFIterator. There are two, because some searches run
+	// another one for every node they visit.
+	enum { NUM_TRAVERSALS = 2 };
+	mutable TraversalContext m_traversals[NUM_TRAVERSALS];
 };
 
 #endif /* EVENTGRAPH_H_ */
@@ -0,0 +1,173 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "FrozenGraph.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "serialize.h"
+
+namespace {
+// Number of nodes the search for the implied arcs into one node visits at most.
+const int kMaxReductionSearchNodes = 4096;
+}  // namespace
+
+FrozenGraph::FrozenGraph() {
+	m_predecessorsBegin.push_back(0);
+	m_successorsBegin.push_back(0);
+}
+
+FrozenGraph::FrozenGraph(const DirectedGraphInterface& graph) {
+	build(graph);
+}
+
+void FrozenGraph::build(const DirectedGraphInterface& graph) {
+	int num_nodes = graph.numNodes();
+	m_deleted.resize(num_nodes);
+	m_predecessorsBegin.resize(num_nodes + 1);
+	m_successorsBegin.resize(num_nodes + 1);
+	size_t num_predecessors = 0, num_successors = 0;
+	for (int i = 0; i < num_nodes; ++i) {
+		m_deleted[i] = graph.isNodeDeleted(i);
+		m_predecessorsBegin[i] = num_predecessors;
+		m_successorsBegin[i] = num_successors;
+		num_predecessors += graph.predecessors(i).size();
+		num_successors += graph.successors(i).size();
+	}
+	m_predecessorsBegin[num_nodes] = num_predecessors;
+	m_successorsBegin[num_nodes] = num_successors;
+
+	m_predecessors.resize(num_predecessors);
+	m_successors.resize(num_successors);
+	for (int i = 0; i < num_nodes; ++i) {
+		NodeSpan predecessors = graph.predecessors(i);
+		std::copy(predecessors.begin(), predecessors.end(), m_predecessors.begin() + m_predecessorsBegin[i]);
+		NodeSpan successors = graph.successors(i);
+		std::copy(successors.begin(), successors.end(), m_successors.begin() + m_successorsBegin[i]);
+	}
+}
+
+int FrozenGraph::buildTransitiveReduction(const DirectedGraphInterface& graph) {
+	int num_nodes = graph.numNodes();
+	m_deleted.resize(num_nodes);
+	m_predecessorsBegin.assign(1, 0);
+	m_predecessors.clear();
+	// The removed arcs as pairs of tail and head.
+	std::vector<std::pair<int, int> > removed;
+
+	TraversalContext context;
+	std::vector<int> sorted, stack;
+	for (int node = 0; node < num_nodes; ++node) {
+		m_deleted[node] = graph.isNodeDeleted(node);
+		NodeSpan predecessors = graph.predecessors(node);
+		sorted.clear();
+		for (size_t i = 0; i < predecessors.size(); ++i) {
+			if (predecessors[i] < node) sorted.push_back(predecessors[i]);
+		}
+		std::sort(sorted.begin(), sorted.end());
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+		size_t num_removed = removed.size();
+		if (sorted.size() > 1) {
+			// An arc from a predecessor is implied if the predecessor reaches a later
+			// predecessor. Search back from the later ones first, on the reduced graph
+			// of the earlier nodes, and not past the first predecessor. Once the search
+			// visited kMaxReductionSearchNodes nodes, it stops and only the arcs from
+			// predecessors it already reached are removed.
+			int first = sorted[0];
+			int num_visited = 0;
+			context.reset(num_nodes);
+			for (size_t i = sorted.size(); i-- > 0; ) {
+				if (num_visited >= kMaxReductionSearchNodes) {
+					if (context.isVisited(sorted[i])) removed.push_back(std::make_pair(sorted[i], node));
+					continue;
+				}
+				if (!context.visit(sorted[i])) {
+					removed.push_back(std::make_pair(sorted[i], node));
+					continue;
+				}
+				++num_visited;
+				stack.push_back(sorted[i]);
+				while (!stack.empty() && num_visited < kMaxReductionSearchNodes) {
+					int current = stack.back();
+					stack.pop_back();
+					for (int j = m_predecessorsBegin[current]; j < m_predecessorsBegin[current + 1]; ++j) {
+						int predecessor = m_predecessors[j];
+						if (predecessor < current && predecessor >= first && context.visit(predecessor)) {
+							stack.push_back(predecessor);
+							++num_visited;
+						}
+					}
+				}
+				stack.clear();
+			}
+			std::sort(removed.begin() + num_removed, removed.end());
+		}
+		for (size_t i = 0; i < predecessors.size(); ++i) {
+			if (!std::binary_search(removed.begin() + num_removed, removed.end(), std::make_pair(predecessors[i], node))) {
+				m_predecessors.push_back(predecessors[i]);
+			}
+		}
+		m_predecessorsBegin.push_back(m_predecessors.size());
+	}
+
+	// The removed arcs are ordered by head, order them by tail.
+	std::sort(removed.begin(), removed.end());
+	m_successorsBegin.assign(1, 0);
+	m_successors.clear();
+	for (int node = 0; node < num_nodes; ++node) {
+		NodeSpan successors = graph.successors(node);
+		for (size_t i = 0; i < successors.size(); ++i) {
+			if (!std::binary_search(removed.begin(), removed.end(), std::make_pair(node, successors[i]))) {
+				m_successors.push_back(successors[i]);
+			}
+		}
+		m_successorsBegin.push_back(m_successors.size());
+	}
+	return removed.size();
+}
+
+void FrozenGraph::saveToFile(FILE* f) const {
+	WriteVector(f, m_deleted);
+	WriteVector(f, m_predecessorsBegin);
+	WriteVector(f, m_successorsBegin);
+	WriteVector(f, m_predecessors);
+	WriteVector(f, m_successors);
+}
+
+bool FrozenGraph::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadVector(data, size, pos, &m_deleted) ||
+			!ReadVector(data, size, pos, &m_predecessorsBegin) ||
+			!ReadVector(data, size, pos, &m_successorsBegin) ||
+			!ReadVector(data, size, pos, &m_predecessors) ||
+			!ReadVector(data, size, pos, &m_successors)) return false;
+	// Check that the offsets are within the arrays.
+	size_t num_nodes = m_deleted.size();
+	if (m_predecessorsBegin.size() != num_nodes + 1 || m_successorsBegin.size() != num_nodes + 1) return false;
+	for (size_t i = 0; i < num_nodes; ++i) {
+		if (m_predecessorsBegin[i] < 0 || m_predecessorsBegin[i] > m_predecessorsBegin[i + 1] ||
+				m_successorsBegin[i] < 0 || m_successorsBegin[i] > m_successorsBegin[i + 1]) return false;
+	}
+	if (static_cast<size_t>(m_predecessorsBegin[num_nodes]) != m_predecessors.size() ||
+			static_cast<size_t>(m_successorsBegin[num_nodes]) != m_successors.size()) return false;
+	for (size_t i = 0; i < m_predecessors.size(); ++i) {
+		if (static_cast<size_t>(m_predecessors[i]) >= num_nodes) return false;
+	}
+	for (size_t i = 0; i < m_successors.size(); ++i) {
+		if (static_cast<size_t>(m_successors[i]) >= num_nodes) return false;
+	}
+	return true;
+}
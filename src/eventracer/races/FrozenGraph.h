@@ -0,0 +1,72 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef FROZENGRAPH_H_
+#define FROZENGRAPH_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+#include "EventGraph.h"
+
+// An immutable copy of a directed graph in compressed sparse row format: the
+// predecessors and the successors of all nodes are stored in two arrays, ordered by
+// node, with the offset of every node in a third and fourth array. Built once the
+// graph no longer changes, for the analyses that only read it.
+class FrozenGraph : public DirectedGraphInterface {
+public:
+	FrozenGraph();
+	explicit FrozenGraph(const DirectedGraphInterface& graph);
+
+	// Copies a graph. Takes O(nodes + arcs) time.
+	void build(const DirectedGraphInterface& graph);
+
+	// Copies a graph without the arcs to a higher id that are implied by a path
+	// through higher ids. Such a path only passes through nodes before the head of
+	// the arc, so happens before is the same for all the connectivity algorithms.
+	// The search for such paths into a node is bounded, so some implied arcs can stay.
+	// Returns the number of removed arcs.
+	int buildTransitiveReduction(const DirectedGraphInterface& graph);
+
+	virtual int numNodes() const { return m_deleted.size(); }
+	virtual bool isNodeDeleted(int node_id) const { return m_deleted[node_id] != 0; }
+	virtual NodeSpan predecessors(int node_id) const {
+		return NodeSpan(m_predecessors.data() + m_predecessorsBegin[node_id],
+				m_predecessorsBegin[node_id + 1] - m_predecessorsBegin[node_id]);
+	}
+	virtual NodeSpan successors(int node_id) const {
+		return NodeSpan(m_successors.data() + m_successorsBegin[node_id],
+				m_successorsBegin[node_id + 1] - m_successorsBegin[node_id]);
+	}
+
+	int numArcs() const { return m_successors.size(); }
+
+	// Saves the graph to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the graph from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+private:
+	std::vector<char> m_deleted;
+	// Per node and one more: the index of its first predecessor/successor.
+	std::vector<int> m_predecessorsBegin;
+	std::vector<int> m_successorsBegin;
+	std::vector<int> m_predecessors;
+	std::vector<int> m_successors;
+};
+
+#endif /* FROZENGRAPH_H_ */
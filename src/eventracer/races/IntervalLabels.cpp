@@ -0,0 +1,205 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "IntervalLabels.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <utility>
+
+#include "serialize.h"
+
+
+namespace {
+
+unsigned int NextRandom(unsigned int* state) {
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+}  // namespace
+
+IntervalLabels::IntervalLabels() : m_numLabelings(0), m_numQueries(0), m_numSearches(0) {
+}
+
+void IntervalLabels::build(const DirectedGraphInterface& graph, int num_labelings) {
+	printf("Computing interval labels...\n");
+	int64 start_time = GetCurrentTimeMicros();
+
+	int num_nodes = graph.numNodes();
+	m_successorsBegin.assign(num_nodes + 1, 0);
+	m_successors.clear();
+	for (int i = 0; i < num_nodes; ++i) {
+		m_successorsBegin[i] = m_successors.size();
+		NodeSpan successors = graph.successors(i);
+		for (size_t j = 0; j < successors.size(); ++j) {
+			if (successors[j] > i) m_successors.push_back(successors[j]);
+		}
+	}
+	m_successorsBegin[num_nodes] = m_successors.size();
+
+	m_numLabelings = std::max(1, num_labelings);
+	m_levels.assign(num_nodes, 0);
+	m_labels.assign(static_cast<size_t>(num_nodes) * m_numLabelings * LABEL_SIZE, 0);
+	computeLevels();
+	for (int i = 0; i < m_numLabelings; ++i) {
+		computeLabeling(i, 0x9e3779b9U * (i + 1));
+	}
+
+	printf("Computing interval labels done... (%lld ms, %lld KB)\n",
+			(GetCurrentTimeMicros() - start_time) / 1000,
+			static_cast<int64>((m_levels.size() + m_labels.size() + m_successorsBegin.size() +
+					m_successors.size()) * sizeof(int) / 1024));
+}
+
+void IntervalLabels::computeLevels() {
+	// The arcs go to higher ids, so the ids are a topological order.
+	for (int i = 0; i < numNodes(); ++i) {
+		for (int j = m_successorsBegin[i]; j < m_successorsBegin[i + 1]; ++j) {
+			int successor = m_successors[j];
+			m_levels[successor] = std::max(m_levels[successor], m_levels[i] + 1);
+		}
+	}
+}
+
+void IntervalLabels::computeLabeling(int labeling, unsigned int seed) {
+	int num_nodes = numNodes();
+	// Start from the nodes with no predecessors in a random order.
+	std::vector<int> roots;
+	for (int i = 0; i < num_nodes; ++i) {
+		if (m_levels[i] == 0) roots.push_back(i);
+	}
+	unsigned int random = seed;
+	for (int i = static_cast<int>(roots.size()) - 1; i > 0; --i) {
+		std::swap(roots[i], roots[NextRandom(&random) % (i + 1)]);
+	}
+
+	std::vector<char> visited(num_nodes, 0);
+	// The node and how many of its successors were visited. The successors of a node
+	// are visited from a random one on.
+	std::vector<std::pair<int, int> > stack;
+	std::vector<int> first_successor(num_nodes, 0);
+	int post_order = 0;
+	for (size_t r = 0; r < roots.size(); ++r) {
+		visited[roots[r]] = 1;
+		stack.push_back(std::make_pair(roots[r], 0));
+		while (!stack.empty()) {
+			int node = stack.back().first;
+			int* node_label = label(node, labeling);
+			int begin = m_successorsBegin[node];
+			int num_successors = m_successorsBegin[node + 1] - begin;
+			int& num_visited = stack.back().second;
+			if (num_visited == 0) {
+				node_label[0] = num_nodes;
+				node_label[1] = post_order;
+				if (num_successors > 0) first_successor[node] = NextRandom(&random) % num_successors;
+			}
+			if (num_visited < num_successors) {
+				int successor = m_successors[begin + (first_successor[node] + num_visited) % num_successors];
+				++num_visited;
+				if (!visited[successor]) {
+					visited[successor] = 1;
+					stack.push_back(std::make_pair(successor, 0));
+				} else {
+					node_label[0] = std::min(node_label[0], label(successor, labeling)[0]);
+				}
+				continue;
+			}
+			node_label[2] = post_order++;
+			node_label[0] = std::min(node_label[0], node_label[2]);
+			stack.pop_back();
+			if (!stack.empty()) {
+				int* parent_label = label(stack.back().first, labeling);
+				parent_label[0] = std::min(parent_label[0], node_label[0]);
+			}
+		}
+	}
+}
+
+bool IntervalLabels::areOrdered(int source, int target) const {
+	if (source == target) return true;
+	if (source > target || source < 0 || target >= numNodes()) return false;
+	__sync_fetch_and_add(&m_numQueries, 1);
+	if (!mayReach(source, target)) return false;
+	if (mustReach(source, target)) return true;
+
+	__sync_fetch_and_add(&m_numSearches, 1);
+	for (int i = 0; i < NUM_TRAVERSALS; ++i) {
+		if (!m_traversals[i].tryAcquire()) continue;
+		bool ordered = search(source, target, &m_traversals[i]);
+		m_traversals[i].release();
+		return ordered;
+	}
+	TraversalContext context;
+	return search(source, target, &context);
+}
+
+bool IntervalLabels::search(int source, int target, TraversalContext* context) const {
+	context->reset(numNodes());
+	std::vector<int>& stack = context->m_next;
+	stack.clear();
+	context->visit(source);
+	stack.push_back(source);
+	while (!stack.empty()) {
+		int node = stack.back();
+		stack.pop_back();
+		for (int j = m_successorsBegin[node]; j < m_successorsBegin[node + 1]; ++j) {
+			int successor = m_successors[j];
+			if (successor == target) return true;
+			if (successor > target || !mayReach(successor, target)) continue;
+			if (mustReach(successor, target)) return true;
+			if (context->visit(successor)) stack.push_back(successor);
+		}
+	}
+	return false;
+}
+
+void IntervalLabels::printStats() const {
+	printf("IntervalLabels: %lld queries, %.1f%% answered by the labels\n", m_numQueries,
+			m_numQueries == 0 ? 0.0 : (m_numQueries - m_numSearches) * 100.0 / m_numQueries);
+}
+
+void IntervalLabels::saveToFile(FILE* f) const {
+	WriteVector(f, m_successorsBegin);
+	WriteVector(f, m_successors);
+	WriteValue(f, m_numLabelings);
+	WriteVector(f, m_levels);
+	WriteVector(f, m_labels);
+}
+
+bool IntervalLabels::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadVector(data, size, pos, &m_successorsBegin) ||
+			!ReadVector(data, size, pos, &m_successors) ||
+			!ReadValue(data, size, pos, &m_numLabelings) ||
+			!ReadVector(data, size, pos, &m_levels) ||
+			!ReadVector(data, size, pos, &m_labels)) return false;
+	// Check that the offsets and the node ids are within the arrays.
+	size_t num_nodes = m_levels.size();
+	if (m_successorsBegin.size() != num_nodes + 1 || m_numLabelings < 1 ||
+			m_labels.size() != num_nodes * m_numLabelings * LABEL_SIZE) return false;
+	for (size_t i = 0; i < num_nodes; ++i) {
+		if (m_successorsBegin[i] < 0 || m_successorsBegin[i] > m_successorsBegin[i + 1]) return false;
+	}
+	if (static_cast<size_t>(m_successorsBegin[num_nodes]) != m_successors.size()) return false;
+	for (size_t i = 0; i < m_successors.size(); ++i) {
+		if (static_cast<size_t>(m_successors[i]) >= num_nodes) return false;
+	}
+	return true;
+}
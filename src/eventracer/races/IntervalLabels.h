@@ -0,0 +1,114 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef INTERVALLABELS_H_
+#define INTERVALLABELS_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#include "base.h"
+#include "EventGraph.h"
+
+// Computes happens before with interval labels (GRAIL). Every labeling numbers the
+// nodes in the post-order of a depth first search and gives each node the interval
+// of the numbers of the nodes it reaches. If a node reaches another, its intervals
+// contain the intervals of the other node and its level (the longest path to it) is
+// lower, so most unordered pairs are told apart from the labels alone. A node also
+// reaches the nodes numbered in its subtree of the search, which answers many ordered
+// pairs. The remaining queries run a depth first search that skips the nodes the
+// labels rule out.
+// Takes O(nodes * labelings) memory.
+//
+// Like ThreadMapping and BitClocks, only arcs to nodes with higher ids are followed.
+class IntervalLabels : public EventGraphInterface {
+public:
+	IntervalLabels();
+
+	void build(const DirectedGraphInterface& graph, int num_labelings);
+
+	virtual bool areOrdered(int source, int target) const;
+
+	// Prints the number of queries and how many were answered by the labels.
+	void printStats() const;
+
+	// Saves the labels and the graph to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the labels from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+private:
+	enum {
+		// Per node and labeling: the lowest post-order number it reaches, the lowest one
+		// in its subtree and its own.
+		LABEL_SIZE = 3,
+		// Number of searches that can run concurrently without allocating.
+		NUM_TRAVERSALS = 4
+	};
+
+	int numNodes() const { return m_levels.size(); }
+
+	void computeLevels();
+	void computeLabeling(int labeling, unsigned int seed);
+
+	const int* label(int node, int labeling) const {
+		return &m_labels[(static_cast<size_t>(node) * m_numLabelings + labeling) * LABEL_SIZE];
+	}
+	int* label(int node, int labeling) {
+		return &m_labels[(static_cast<size_t>(node) * m_numLabelings + labeling) * LABEL_SIZE];
+	}
+
+	// Whether the labels allow a path from source to target.
+	bool mayReach(int source, int target) const {
+		if (m_levels[source] >= m_levels[target]) return false;
+		const int* s = label(source, 0);
+		const int* t = label(target, 0);
+		for (int i = 0; i < m_numLabelings * LABEL_SIZE; i += LABEL_SIZE) {
+			if (s[i] > t[i] || s[i + 2] < t[i + 2]) return false;
+		}
+		return true;
+	}
+
+	// Whether target is in the subtree of source in the first search.
+	bool mustReach(int source, int target) const {
+		const int* s = label(source, 0);
+		int t = label(target, 0)[2];
+		return s[1] <= t && t <= s[2];
+	}
+
+	bool search(int source, int target, TraversalContext* context) const;
+
+	// The graph without the arcs to nodes with lower ids, in compressed sparse row format.
+	std::vector<int> m_successorsBegin;
+	std::vector<int> m_successors;
+
+	int m_numLabelings;
+	// Per node: the number of arcs on the longest path to it.
+	std::vector<int> m_levels;
+	std::vector<int> m_labels;
+
+	mutable TraversalContext m_traversals[NUM_TRAVERSALS];
+	mutable int64 m_numQueries;
+	mutable int64 m_numSearches;
+
+	// Deleted.
+	IntervalLabels(const IntervalLabels&);
+	IntervalLabels& operator=(const IntervalLabels&);
+};
+
+#endif /* INTERVALLABELS_H_ */
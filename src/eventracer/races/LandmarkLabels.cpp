@@ -0,0 +1,256 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "LandmarkLabels.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <utility>
+
+#include "base.h"
+#include "serialize.h"
+#include "thread_pool.h"
+
+
+namespace {
+
+// The graph without the arcs to nodes with lower ids.
+struct ForwardGraph {
+	std::vector<int> m_successorsBegin;
+	std::vector<int> m_successors;
+	std::vector<int> m_predecessorsBegin;
+	std::vector<int> m_predecessors;
+};
+
+// Whether two sorted arrays have a common value.
+bool Intersect(const int* a, const int* a_end, const int* b, const int* b_end) {
+	while (a != a_end && b != b_end) {
+		if (*a < *b) {
+			++a;
+		} else if (*b < *a) {
+			++b;
+		} else {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Intersect(const std::vector<int>& a, const std::vector<int>& b) {
+	return Intersect(a.data(), a.data() + a.size(), b.data(), b.data() + b.size());
+}
+
+}  // namespace
+
+// Runs the pruned searches from some of the nodes of a batch and collects the nodes
+// that get their rank in a label.
+class LandmarkLabels::SearchTask : public ThreadTask {
+public:
+	SearchTask(const ForwardGraph& graph,
+			const std::vector<std::vector<int> >& out_labels,
+			const std::vector<std::vector<int> >& in_labels)
+		: m_graph(graph), m_outLabels(out_labels), m_inLabels(in_labels),
+		  m_landmarks(NULL), m_first(0), m_step(1), m_reachedFrom(NULL), m_reaching(NULL) {
+	}
+
+	// Searches from landmarks[first], landmarks[first + step], ... and stores the
+	// reached nodes at the same positions of reached_from and reaching.
+	void setBatch(const std::vector<int>* landmarks, int first, int step,
+			std::vector<std::vector<int> >* reached_from, std::vector<std::vector<int> >* reaching) {
+		m_landmarks = landmarks;
+		m_first = first;
+		m_step = step;
+		m_reachedFrom = reached_from;
+		m_reaching = reaching;
+	}
+
+	virtual void run() {
+		for (size_t i = m_first; i < m_landmarks->size(); i += m_step) {
+			int landmark = (*m_landmarks)[i];
+			search(landmark, true, &(*m_reachedFrom)[i]);
+			search(landmark, false, &(*m_reaching)[i]);
+		}
+	}
+
+private:
+	void search(int landmark, bool forward, std::vector<int>* reached) {
+		reached->clear();
+		m_context.reset(m_graph.m_successorsBegin.size() - 1);
+		m_context.visit(landmark);
+		m_queue.clear();
+		m_queue.push_back(landmark);
+		for (size_t i = 0; i < m_queue.size(); ++i) {
+			int node = m_queue[i];
+			// Stop at the nodes the earlier labels already connect to the landmark.
+			if (forward ? Intersect(m_outLabels[landmark], m_inLabels[node]) :
+					Intersect(m_outLabels[node], m_inLabels[landmark])) continue;
+			reached->push_back(node);
+			const std::vector<int>& begin = forward ? m_graph.m_successorsBegin : m_graph.m_predecessorsBegin;
+			const std::vector<int>& followers = forward ? m_graph.m_successors : m_graph.m_predecessors;
+			for (int j = begin[node]; j < begin[node + 1]; ++j) {
+				if (m_context.visit(followers[j])) m_queue.push_back(followers[j]);
+			}
+		}
+	}
+
+	const ForwardGraph& m_graph;
+	const std::vector<std::vector<int> >& m_outLabels;
+	const std::vector<std::vector<int> >& m_inLabels;
+	const std::vector<int>* m_landmarks;
+	int m_first;
+	int m_step;
+	std::vector<std::vector<int> >* m_reachedFrom;
+	std::vector<std::vector<int> >* m_reaching;
+
+	TraversalContext m_context;
+	std::vector<int> m_queue;
+};
+
+LandmarkLabels::LandmarkLabels() {
+	m_outBegin.push_back(0);
+	m_inBegin.push_back(0);
+}
+
+void LandmarkLabels::build(const DirectedGraphInterface& graph, ThreadPool* pool) {
+	printf("Computing landmark labels...\n");
+	int64 start_time = GetCurrentTimeMicros();
+
+	int num_nodes = graph.numNodes();
+	ForwardGraph forward_graph;
+	forward_graph.m_successorsBegin.resize(num_nodes + 1);
+	forward_graph.m_predecessorsBegin.resize(num_nodes + 1);
+	for (int i = 0; i < num_nodes; ++i) {
+		forward_graph.m_successorsBegin[i] = forward_graph.m_successors.size();
+		NodeSpan successors = graph.successors(i);
+		for (size_t j = 0; j < successors.size(); ++j) {
+			if (successors[j] > i) forward_graph.m_successors.push_back(successors[j]);
+		}
+		forward_graph.m_predecessorsBegin[i] = forward_graph.m_predecessors.size();
+		NodeSpan predecessors = graph.predecessors(i);
+		for (size_t j = 0; j < predecessors.size(); ++j) {
+			if (predecessors[j] < i) forward_graph.m_predecessors.push_back(predecessors[j]);
+		}
+	}
+	forward_graph.m_successorsBegin[num_nodes] = forward_graph.m_successors.size();
+	forward_graph.m_predecessorsBegin[num_nodes] = forward_graph.m_predecessors.size();
+
+	// Nodes with many arcs connect many pairs, so they get the first ranks.
+	std::vector<std::pair<int64, int> > order(num_nodes);
+	for (int i = 0; i < num_nodes; ++i) {
+		int64 num_successors = forward_graph.m_successorsBegin[i + 1] - forward_graph.m_successorsBegin[i];
+		int64 num_predecessors = forward_graph.m_predecessorsBegin[i + 1] - forward_graph.m_predecessorsBegin[i];
+		order[i] = std::make_pair(-(num_successors + 1) * (num_predecessors + 1), i);
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<std::vector<int> > out_labels(num_nodes), in_labels(num_nodes);
+	int num_tasks = pool != NULL ? pool->numThreads() : 1;
+	std::vector<SearchTask*> tasks;
+	for (int i = 0; i < num_tasks; ++i) {
+		tasks.push_back(new SearchTask(forward_graph, out_labels, in_labels));
+	}
+	std::vector<int> landmarks;
+	std::vector<std::vector<int> > reached_from, reaching;
+	int num_batches = 0;
+	for (int rank = 0; rank < num_nodes; ) {
+		// A batch does not see the labels of its own nodes, so the batches start small
+		// while the first nodes still connect most pairs.
+		int batch_size = num_tasks == 1 ? 1 : std::max(num_tasks, rank / 16);
+		batch_size = std::min(batch_size, num_nodes - rank);
+		landmarks.resize(batch_size);
+		for (int i = 0; i < batch_size; ++i) {
+			landmarks[i] = order[rank + i].second;
+		}
+		reached_from.resize(batch_size);
+		reaching.resize(batch_size);
+		for (int i = 0; i < num_tasks; ++i) {
+			tasks[i]->setBatch(&landmarks, i, num_tasks, &reached_from, &reaching);
+		}
+		if (num_tasks == 1) {
+			tasks[0]->run();
+		} else {
+			for (int i = 0; i < num_tasks; ++i) {
+				pool->add(tasks[i]);
+			}
+			pool->wait();
+		}
+
+		// The ranks are added in increasing order, so the labels stay sorted.
+		for (int i = 0; i < batch_size; ++i) {
+			for (size_t j = 0; j < reached_from[i].size(); ++j) {
+				in_labels[reached_from[i][j]].push_back(rank + i);
+			}
+			for (size_t j = 0; j < reaching[i].size(); ++j) {
+				out_labels[reaching[i][j]].push_back(rank + i);
+			}
+		}
+		rank += batch_size;
+		++num_batches;
+	}
+	for (int i = 0; i < num_tasks; ++i) {
+		delete tasks[i];
+	}
+
+	m_outBegin.assign(1, 0);
+	m_out.clear();
+	m_inBegin.assign(1, 0);
+	m_in.clear();
+	size_t max_label = 0;
+	for (int i = 0; i < num_nodes; ++i) {
+		m_out.insert(m_out.end(), out_labels[i].begin(), out_labels[i].end());
+		m_outBegin.push_back(m_out.size());
+		m_in.insert(m_in.end(), in_labels[i].begin(), in_labels[i].end());
+		m_inBegin.push_back(m_in.size());
+		max_label = std::max(max_label, std::max(out_labels[i].size(), in_labels[i].size()));
+	}
+
+	printf("Computing landmark labels done... (%lld ms, %d batches)\n",
+			(GetCurrentTimeMicros() - start_time) / 1000, num_batches);
+	printf("LandmarkLabels: %d out and %d in label entries, %.1f per node, at most %d, %lld KB\n",
+			static_cast<int>(m_out.size()), static_cast<int>(m_in.size()),
+			num_nodes == 0 ? 0.0 : (m_out.size() + m_in.size()) / static_cast<double>(num_nodes),
+			static_cast<int>(max_label),
+			static_cast<int64>((m_outBegin.size() + m_out.size() + m_inBegin.size() + m_in.size()) * sizeof(int) / 1024));
+}
+
+bool LandmarkLabels::areOrdered(int source, int target) const {
+	if (source == target) return true;
+	if (source > target || source < 0 || target >= numNodes()) return false;
+	return Intersect(m_out.data() + m_outBegin[source], m_out.data() + m_outBegin[source + 1],
+			m_in.data() + m_inBegin[target], m_in.data() + m_inBegin[target + 1]);
+}
+
+void LandmarkLabels::saveToFile(FILE* f) const {
+	WriteVector(f, m_outBegin);
+	WriteVector(f, m_out);
+	WriteVector(f, m_inBegin);
+	WriteVector(f, m_in);
+}
+
+bool LandmarkLabels::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadVector(data, size, pos, &m_outBegin) ||
+			!ReadVector(data, size, pos, &m_out) ||
+			!ReadVector(data, size, pos, &m_inBegin) ||
+			!ReadVector(data, size, pos, &m_in)) return false;
+	// Check that the offsets are within the arrays.
+	if (m_outBegin.empty() || m_inBegin.size() != m_outBegin.size()) return false;
+	for (size_t i = 0; i + 1 < m_outBegin.size(); ++i) {
+		if (m_outBegin[i] < 0 || m_outBegin[i] > m_outBegin[i + 1] ||
+				m_inBegin[i] < 0 || m_inBegin[i] > m_inBegin[i + 1]) return false;
+	}
+	return static_cast<size_t>(m_outBegin.back()) == m_out.size() &&
+			static_cast<size_t>(m_inBegin.back()) == m_in.size();
+}
@@ -0,0 +1,68 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef LANDMARKLABELS_H_
+#define LANDMARKLABELS_H_
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+#include "EventGraph.h"
+
+class ThreadPool;
+
+// Computes happens before with a pruned landmark (2-hop) labeling. The nodes are
+// ranked and every node gets the sorted ranks of the nodes it reaches in its out
+// label and of the nodes that reach it in its in label. A node reaches another if
+// the out label of the first and the in label of the second share a rank. The
+// labels are filled by a search from every node in the order of the ranks, which
+// stops at the nodes the earlier labels already connect, so most labels stay short.
+//
+// Like ThreadMapping and BitClocks, only arcs to nodes with higher ids are followed.
+class LandmarkLabels : public EventGraphInterface {
+public:
+	LandmarkLabels();
+
+	// Builds the labels. With a pool, the searches of a batch of nodes run in
+	// parallel and only stop at the nodes connected by the earlier batches.
+	void build(const DirectedGraphInterface& graph, ThreadPool* pool);
+
+	virtual bool areOrdered(int source, int target) const;
+
+	// Saves the labels to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the labels from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+private:
+	class SearchTask;
+
+	int numNodes() const { return static_cast<int>(m_outBegin.size()) - 1; }
+
+	// The labels of every node in compressed sparse row format.
+	std::vector<int> m_outBegin;
+	std::vector<int> m_out;
+	std::vector<int> m_inBegin;
+	std::vector<int> m_in;
+
+	// Deleted.
+	LandmarkLabels(const LandmarkLabels&);
+	LandmarkLabels& operator=(const LandmarkLabels&);
+};
+
+#endif /* LANDMARKLABELS_H_ */
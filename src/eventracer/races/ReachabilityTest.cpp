@@ -0,0 +1,303 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Checks the connectivity backends against a depth first search on random graphs.
+
+#include "BFSReachability.h"
+#include "EventGraph.h"
+#include "FrozenGraph.h"
+#include "IntervalLabels.h"
+#include "LandmarkLabels.h"
+#include "thread_pool.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+void expectTrue(bool condition, const char* what) {
+	if (!condition) {
+		fprintf(stderr, "Test failed: %s\n^^^ FAIL ^^^\n", what);
+		throw 0;
+	}
+}
+
+unsigned int nextRandom(unsigned int* state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 8;
+}
+
+// Builds a graph where every node has up to max_arcs arcs from the span nodes before
+// it, then deletes every delete_every-th node (none if 0).
+void buildRandomGraph(int num_nodes, int span, int max_arcs, int delete_every, unsigned int* random,
+		SimpleDirectedGraph* graph) {
+	graph->createEmptyGraph(num_nodes);
+	for (int i = 1; i < num_nodes; ++i) {
+		int num_arcs = nextRandom(random) % (max_arcs + 1);
+		for (int k = 0; k < num_arcs; ++k) {
+			int j = i - 1 - static_cast<int>(nextRandom(random) % span);
+			if (j >= 0 && !graph->hasArc(j, i)) graph->addArc(j, i);
+		}
+	}
+	if (delete_every == 0) return;
+	for (int i = delete_every / 2; i < num_nodes; i += delete_every) {
+		graph->deleteNode(i);
+	}
+}
+
+// The reference answers: whether a node reaches another over arcs to higher ids,
+// found by a depth first search from every node.
+class ReachabilityMatrix {
+public:
+	explicit ReachabilityMatrix(const DirectedGraphInterface& graph)
+		: m_numNodes(graph.numNodes()), m_words(m_numNodes / 32 + 1),
+		  m_reaches(static_cast<size_t>(m_numNodes) * m_words, 0) {
+		std::vector<int> stack;
+		for (int source = 0; source < m_numNodes; ++source) {
+			unsigned int* reached = &m_reaches[static_cast<size_t>(source) * m_words];
+			reached[source / 32] |= 1u << (source % 32);
+			stack.push_back(source);
+			while (!stack.empty()) {
+				int node = stack.back();
+				stack.pop_back();
+				NodeSpan successors = graph.successors(node);
+				for (size_t i = 0; i < successors.size(); ++i) {
+					int successor = successors[i];
+					if (successor <= node || (reached[successor / 32] >> (successor % 32)) & 1) continue;
+					reached[successor / 32] |= 1u << (successor % 32);
+					stack.push_back(successor);
+				}
+			}
+		}
+	}
+
+	bool reaches(int source, int target) const {
+		return (m_reaches[static_cast<size_t>(source) * m_words + target / 32] >> (target % 32)) & 1;
+	}
+
+	bool operator==(const ReachabilityMatrix& other) const { return m_reaches == other.m_reaches; }
+
+private:
+	int m_numNodes;
+	int m_words;
+	std::vector<unsigned int> m_reaches;
+};
+
+// Checks the answers of a backend for every pair of nodes that are not deleted.
+void expectSameAnswers(const SimpleDirectedGraph& graph, const ReachabilityMatrix& expected,
+		const EventGraphInterface& backend, const char* what) {
+	for (int i = 0; i < graph.numNodes(); ++i) {
+		if (graph.isNodeDeleted(i)) continue;
+		for (int j = 0; j < graph.numNodes(); ++j) {
+			if (graph.isNodeDeleted(j)) continue;
+			expectTrue(backend.areOrdered(i, j) == expected.reaches(i, j), what);
+		}
+	}
+}
+
+// Queries all pairs of nodes from a thread, starting at a different node on each one.
+class QueryTask : public ThreadTask {
+public:
+	QueryTask(const SimpleDirectedGraph& graph, const ReachabilityMatrix& expected,
+			const EventGraphInterface& backend, int first_node)
+		: m_graph(graph), m_expected(expected), m_backend(backend), m_firstNode(first_node),
+		  m_numErrors(0) {}
+
+	virtual void run() {
+		int num_nodes = m_graph.numNodes();
+		for (int k = 0; k < num_nodes; ++k) {
+			int i = (m_firstNode + k) % num_nodes;
+			if (m_graph.isNodeDeleted(i)) continue;
+			for (int j = 0; j < num_nodes; ++j) {
+				if (m_graph.isNodeDeleted(j)) continue;
+				if (m_backend.areOrdered(i, j) != m_expected.reaches(i, j)) ++m_numErrors;
+			}
+		}
+	}
+
+	int numErrors() const { return m_numErrors; }
+
+private:
+	const SimpleDirectedGraph& m_graph;
+	const ReachabilityMatrix& m_expected;
+	const EventGraphInterface& m_backend;
+	int m_firstNode;
+	int m_numErrors;
+};
+
+// Runs the queries of all pairs from several threads at once, twice, so that the
+// second round also reads the answers cached by the first.
+void expectSameConcurrentAnswers(const SimpleDirectedGraph& graph, const ReachabilityMatrix& expected,
+		const EventGraphInterface& backend, const char* what) {
+	// More threads than a backend has traversal contexts.
+	const int num_threads = 6;
+	ThreadPool pool(num_threads);
+	std::vector<QueryTask*> tasks;
+	for (int i = 0; i < num_threads; ++i) {
+		tasks.push_back(new QueryTask(graph, expected, backend, i * graph.numNodes() / num_threads));
+	}
+	for (int round = 0; round < 2; ++round) {
+		for (int i = 0; i < num_threads; ++i) {
+			pool.add(tasks[i]);
+		}
+		pool.wait();
+	}
+	int num_errors = 0;
+	for (int i = 0; i < num_threads; ++i) {
+		num_errors += tasks[i]->numErrors();
+		delete tasks[i];
+	}
+	expectTrue(num_errors == 0, what);
+}
+
+void testBFSReachability() {
+	printf("Starting test testBFSReachability...\n");
+	unsigned int random = 1;
+	for (int n = 0; n < 6; ++n) {
+		SimpleDirectedGraph graph;
+		buildRandomGraph(40 + n * 40, 2 + n * 8, 1 + n % 3, n % 2 == 1 ? 7 : 0, &random, &graph);
+		ReachabilityMatrix expected(graph);
+		BFSReachability bfs;
+		bfs.build(graph);
+		char what[64];
+		snprintf(what, sizeof(what), "BFS random graph %d", n);
+		expectSameAnswers(graph, expected, bfs, what);
+		snprintf(what, sizeof(what), "BFS random graph %d from several threads", n);
+		expectSameConcurrentAnswers(graph, expected, bfs, what);
+	}
+}
+
+void testIntervalLabels() {
+	printf("Starting test testIntervalLabels...\n");
+	unsigned int random = 2;
+	for (int n = 0; n < 6; ++n) {
+		SimpleDirectedGraph graph;
+		buildRandomGraph(40 + n * 40, 2 + n * 8, 1 + n % 3, n % 2 == 1 ? 5 : 0, &random, &graph);
+		ReachabilityMatrix expected(graph);
+		// One labeling leaves more pairs to the search than three.
+		for (int num_labelings = 1; num_labelings <= 3; num_labelings += 2) {
+			IntervalLabels labels;
+			labels.build(graph, num_labelings);
+			char what[64];
+			snprintf(what, sizeof(what), "GRAIL with %d labelings, random graph %d", num_labelings, n);
+			expectSameAnswers(graph, expected, labels, what);
+		}
+	}
+}
+
+void testLandmarkLabels() {
+	printf("Starting test testLandmarkLabels...\n");
+	// With four threads every batch has at least four landmarks, which do not prune
+	// each other's searches.
+	ThreadPool pool(4);
+	unsigned int random = 3;
+	for (int n = 0; n < 6; ++n) {
+		SimpleDirectedGraph graph;
+		buildRandomGraph(40 + n * 60, 2 + n * 10, 1 + n % 3, n % 2 == 1 ? 6 : 0, &random, &graph);
+		ReachabilityMatrix expected(graph);
+		char what[64];
+		LandmarkLabels labels;
+		labels.build(graph, NULL);
+		snprintf(what, sizeof(what), "landmarks without a pool, random graph %d", n);
+		expectSameAnswers(graph, expected, labels, what);
+		LandmarkLabels batched_labels;
+		batched_labels.build(graph, &pool);
+		snprintf(what, sizeof(what), "landmarks in batches, random graph %d", n);
+		expectSameAnswers(graph, expected, batched_labels, what);
+	}
+}
+
+// Returns the number of arcs to higher ids that are implied by another path.
+int countImpliedArcs(const DirectedGraphInterface& graph, const ReachabilityMatrix& reachability) {
+	int num_implied = 0;
+	for (int tail = 0; tail < graph.numNodes(); ++tail) {
+		NodeSpan successors = graph.successors(tail);
+		for (size_t i = 0; i < successors.size(); ++i) {
+			int head = successors[i];
+			if (head <= tail) continue;
+			for (size_t j = 0; j < successors.size(); ++j) {
+				if (successors[j] > tail && successors[j] < head && reachability.reaches(successors[j], head)) {
+					++num_implied;
+					break;
+				}
+			}
+		}
+	}
+	return num_implied;
+}
+
+// Checks that the reduction of a graph keeps the reachability and returns the number
+// of removed arcs.
+int expectSameReachability(const SimpleDirectedGraph& graph, const ReachabilityMatrix& expected,
+		const char* name) {
+	FrozenGraph reduced;
+	int num_removed = reduced.buildTransitiveReduction(graph);
+	FrozenGraph copy(graph);
+	char what[128];
+	snprintf(what, sizeof(what), "%s: removed arcs", name);
+	expectTrue(reduced.numArcs() == copy.numArcs() - num_removed, what);
+	for (int i = 0; i < graph.numNodes(); ++i) {
+		expectTrue(reduced.isNodeDeleted(i) == graph.isNodeDeleted(i), what);
+	}
+	snprintf(what, sizeof(what), "%s: same reachability", name);
+	expectTrue(ReachabilityMatrix(reduced) == expected, what);
+	snprintf(what, sizeof(what), "%s: only implied arcs removed", name);
+	expectTrue(num_removed <= countImpliedArcs(graph, expected), what);
+	printf("%s: removed %d of %d arcs\n", name, num_removed, copy.numArcs());
+	return num_removed;
+}
+
+void testTransitiveReduction() {
+	printf("Starting test testTransitiveReduction...\n");
+	unsigned int random = 4;
+	for (int n = 0; n < 6; ++n) {
+		SimpleDirectedGraph graph;
+		buildRandomGraph(40 + n * 60, 2 + n * 10, 2 + n % 3, n % 2 == 1 ? 6 : 0, &random, &graph);
+		ReachabilityMatrix expected(graph);
+		char name[64];
+		snprintf(name, sizeof(name), "reduction of random graph %d", n);
+		// The searches of these graphs are not cut off, so all implied arcs are removed.
+		expectTrue(expectSameReachability(graph, expected, name) == countImpliedArcs(graph, expected), name);
+	}
+
+	// Short arcs connect most nodes and some arcs come from far back. The search for
+	// the implied arcs into the head of a long arc visits the nodes after its tail,
+	// more than the 4096 the search is bounded to, so some long arcs stay.
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(8000);
+	for (int i = 1; i < 8000; ++i) {
+		for (int k = 0; k < 2; ++k) {
+			int j = i - 1 - static_cast<int>(nextRandom(&random) % 20);
+			if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+		}
+		if (nextRandom(&random) % 8 == 0) {
+			int j = i - 1 - static_cast<int>(nextRandom(&random) % 8000);
+			if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+		}
+	}
+	graph.deleteNode(4000);
+	ReachabilityMatrix expected(graph);
+	int num_removed = expectSameReachability(graph, expected, "reduction of a large graph");
+	expectTrue(num_removed < countImpliedArcs(graph, expected), "search for implied arcs bounded");
+}
+
+int main(void) {
+	testBFSReachability();
+	testIntervalLabels();
+	testLandmarkLabels();
+	testTransitiveReduction();
+	printf("All tests passed.\n");
+	return 0;
+}
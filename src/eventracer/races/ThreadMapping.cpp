@@ -17,15 +17,26 @@
 #include "ThreadMapping.h"
 
 #include "base.h"
+#include "serialize.h"
 
 #include <stdio.h>
+#include <algorithm>
 
-#include <emmintrin.h>
+#include <immintrin.h>
 
-ThreadMapping::ThreadMapping() : m_numThreads(0) {
+namespace {
+// Number of nodes a search for the continuation of a thread visits at most.
+const int kMaxLinkSearchNodes = 4096;
+// Number of nodes of other threads the greedy mapping passes in a row at most while
+// looking for more nodes of a thread. Without a bound, walking the same long thread
+// again from many start nodes takes quadratic time.
+const int kMaxMappedRunNodes = 64;
+}  // namespace
+
+ThreadMapping::ThreadMapping() : m_numThreads(0), m_clockSize(2) {
 }
 
-void ThreadMapping::build(const SimpleDirectedGraph& graph) {
+void ThreadMapping::build(const DirectedGraphInterface& graph) {
 	printf("ThreadMapping: Computing threads...\n");
 	int64 start_time = GetCurrentTimeMicros();
 	// Greedy algorithm for mapping nodes to threads.
@@ -37,31 +48,33 @@ void ThreadMapping::build(const SimpleDirectedGraph& graph) {
 			++m_numThreads;
 		}
 	}
+	updateClockSize();
 	printf("ThreadMapping: Found %d threads for %lld ms\n", m_numThreads, (GetCurrentTimeMicros() - start_time) / 1000);
 }
 
-void ThreadMapping::assignNodesToThread(const SimpleDirectedGraph& graph, int startNode, int threadId) {
+void ThreadMapping::assignNodesToThread(const DirectedGraphInterface& graph, int startNode, int threadId) {
 	int nodeId = startNode;
-	int num_nodes_in_chain = 0;
+	int mappedRun = 0;
 	for (;;) {
 		if (m_nodeThread[nodeId] == -1) {
 			m_nodeThread[nodeId] = threadId;
+			mappedRun = 0;
+		} else if (++mappedRun > kMaxMappedRunNodes) {
+			break;
 		}
 		int nextNode = -1;
-		const std::vector<int>& next = graph.nodeSuccessors(nodeId);
+		NodeSpan next = graph.successors(nodeId);
 		for (size_t i = 0; i < next.size(); ++i) {
-			if (m_nodeThread[next[i]] == -1) {
+			if (next[i] > nodeId && m_nodeThread[next[i]] == -1) {
 				nextNode = next[i];
 				break;
 			}
 		}
-		if (nextNode == -1 && next.size() > 0) {
-			nextNode = next[0];
+		for (size_t i = 0; nextNode == -1 && i < next.size(); ++i) {
+			if (next[i] > nodeId) nextNode = next[i];
 		}
 		if (nextNode == -1) break;
 		nodeId = nextNode;
-		++num_nodes_in_chain;
-		if (num_nodes_in_chain == 32766) break;
 	}
 /*
 	// Note: For evaluating no chain cover.
@@ -69,51 +82,325 @@ void ThreadMapping::assignNodesToThread(const SimpleDirectedGraph& graph, int st
 */
 }
 
-namespace {
-void maxVector(std::vector<short>* outv, const std::vector<short>& inv) {
-/*	for (size_t i = 0; i < inv.size(); ++i) {
-		//(*outv)[i] = std::max((*outv)[i], inv[i]);
-		if (inv[i] > (*outv)[i]) {
-			(*outv)[i] = inv[i];
+void ThreadMapping::buildChainCover(const DirectedGraphInterface& graph) {
+	printf("ThreadMapping: Computing chain cover...\n");
+	int64 start_time = GetCurrentTimeMicros();
+	int num_nodes = graph.numNodes();
+	// The next node of every node in its thread or -1.
+	std::vector<int> next;
+	matchArcs(graph, &next);
+	linkChains(graph, &next);
+
+	std::vector<char> has_previous(num_nodes, 0);
+	for (int i = 0; i < num_nodes; ++i) {
+		if (next[i] != -1) has_previous[next[i]] = 1;
+	}
+	m_nodeThread.assign(num_nodes, -1);
+	m_numThreads = 0;
+	for (int i = 0; i < num_nodes; ++i) {
+		if (has_previous[i] || graph.isNodeDeleted(i)) continue;
+		for (int node = i; node != -1; node = next[node]) {
+			m_nodeThread[node] = m_numThreads;
 		}
-	}*/
+		++m_numThreads;
+	}
+	updateClockSize();
+	printf("ThreadMapping: Found %d threads for %lld ms\n", m_numThreads, (GetCurrentTimeMicros() - start_time) / 1000);
+}
 
-	int invsize = inv.size();
-	int is8 = invsize / 8;
+void ThreadMapping::matchArcs(const DirectedGraphInterface& graph, std::vector<int>* next) const {
+	int num_nodes = graph.numNodes();
+	// Only arcs to later nodes between nodes that are not deleted can be in a thread.
+	std::vector<int> arcs_begin(1, 0), arcs;
+	for (int i = 0; i < num_nodes; ++i) {
+		if (!graph.isNodeDeleted(i)) {
+			NodeSpan successors = graph.successors(i);
+			for (size_t j = 0; j < successors.size(); ++j) {
+				if (successors[j] > i && !graph.isNodeDeleted(successors[j])) arcs.push_back(successors[j]);
+			}
+		}
+		arcs_begin.push_back(arcs.size());
+	}
 
-	__m128i* a = (__m128i*) outv->data();
-	__m128i* b = (__m128i*) inv.data();
-	for (int i = 0; i < is8; ++i) {
-		*a = _mm_max_epi16(*a, *b);
-		++a;
-		++b;
+	// Hopcroft-Karp. match_tail is the node matched to an arc head or -1.
+	const int kInfinity = num_nodes + 1;
+	next->assign(num_nodes, -1);
+	std::vector<int>& match_head = *next;
+	std::vector<int> match_tail(num_nodes, -1);
+	std::vector<int> distance(num_nodes);
+	std::vector<int> queue, stack, arc(num_nodes);
+	for (;;) {
+		// Order the unmatched tails and the tails reachable from them by alternating
+		// paths into layers.
+		queue.clear();
+		for (int i = 0; i < num_nodes; ++i) {
+			if (match_head[i] == -1 && arcs_begin[i] != arcs_begin[i + 1]) {
+				distance[i] = 0;
+				queue.push_back(i);
+			} else {
+				distance[i] = kInfinity;
+			}
+		}
+		bool found = false;
+		for (size_t q = 0; q < queue.size(); ++q) {
+			int tail = queue[q];
+			for (int j = arcs_begin[tail]; j < arcs_begin[tail + 1]; ++j) {
+				int matched = match_tail[arcs[j]];
+				if (matched == -1) {
+					found = true;
+				} else if (distance[matched] == kInfinity) {
+					distance[matched] = distance[tail] + 1;
+					queue.push_back(matched);
+				}
+			}
+		}
+		if (!found) break;
+
+		// Augment along vertex disjoint shortest paths, searching without recursion.
+		for (int i = 0; i < num_nodes; ++i) {
+			arc[i] = arcs_begin[i];
+		}
+		for (int i = 0; i < num_nodes; ++i) {
+			if (match_head[i] != -1 || distance[i] != 0) continue;
+			stack.assign(1, i);
+			while (!stack.empty()) {
+				int tail = stack.back();
+				if (arc[tail] == arcs_begin[tail + 1]) {
+					distance[tail] = kInfinity;
+					stack.pop_back();
+					if (!stack.empty()) ++arc[stack.back()];
+					continue;
+				}
+				int matched = match_tail[arcs[arc[tail]]];
+				if (matched == -1) {
+					for (size_t k = 0; k < stack.size(); ++k) {
+						int head = arcs[arc[stack[k]]];
+						match_head[stack[k]] = head;
+						match_tail[head] = stack[k];
+					}
+					break;
+				}
+				if (distance[matched] == distance[tail] + 1) {
+					stack.push_back(matched);
+				} else {
+					++arc[tail];
+				}
+			}
+		}
 	}
-	for (int i = is8 * 8; i < invsize; ++i) {
-		if (inv[i] > (*outv)[i]) {
-			(*outv)[i] = inv[i];
+}
+
+void ThreadMapping::linkChains(const DirectedGraphInterface& graph, std::vector<int>* next) const {
+	int num_nodes = graph.numNodes();
+	std::vector<char> has_previous(num_nodes, 0);
+	for (int i = 0; i < num_nodes; ++i) {
+		if ((*next)[i] != -1) has_previous[(*next)[i]] = 1;
+	}
+	// A thread may continue at any node its last node reaches, so join it with the
+	// first thread whose first node a bounded search from its last node finds.
+	TraversalContext context;
+	std::vector<int> queue;
+	for (int i = 0; i < num_nodes; ++i) {
+		if ((*next)[i] != -1 || graph.isNodeDeleted(i)) continue;
+		context.reset(num_nodes);
+		context.visit(i);
+		queue.assign(1, i);
+		for (size_t q = 0; q < queue.size() && q < static_cast<size_t>(kMaxLinkSearchNodes); ++q) {
+			int node = queue[q];
+			if (node != i && !has_previous[node] && !graph.isNodeDeleted(node)) {
+				(*next)[i] = node;
+				has_previous[node] = 1;
+				break;
+			}
+			NodeSpan successors = graph.successors(node);
+			for (size_t j = 0; j < successors.size(); ++j) {
+				if (successors[j] > node && context.visit(successors[j])) queue.push_back(successors[j]);
+			}
 		}
 	}
 }
+
+namespace {
+
+template <class T>
+void MaxVectorScalar(T* out, const T* in, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		if (in[i] > out[i]) out[i] = in[i];
+	}
+}
+
+void MaxVector8Sse2(unsigned char* out, const unsigned char* in, size_t size) {
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epu8(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void MaxVector8Avx2(unsigned char* out, const unsigned char* in, size_t size) {
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_max_epu8(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void MaxVector16Sse41(unsigned short* out, const unsigned short* in, size_t size) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epu16(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void MaxVector16Avx2(unsigned short* out, const unsigned short* in, size_t size) {
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_max_epu16(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void MaxVector32Sse41(unsigned int* out, const unsigned int* in, size_t size) {
+	size_t i = 0;
+	for (; i + 4 <= size; i += 4) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_max_epu32(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void MaxVector32Avx2(unsigned int* out, const unsigned int* in, size_t size) {
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_max_epu32(a, b));
+	}
+	MaxVectorScalar(out + i, in + i, size - i);
+}
+
+bool HasAvx2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+bool HasSse41() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+// The element-wise maximum of two clocks with the widest vector instructions the
+// processor has.
+template <class T>
+struct MaxVector {
+	static void (*const run)(T* out, const T* in, size_t size);
+};
+
+template <>
+void (*const MaxVector<unsigned char>::run)(unsigned char*, const unsigned char*, size_t) =
+		HasAvx2() ? MaxVector8Avx2 : MaxVector8Sse2;
+template <>
+void (*const MaxVector<unsigned short>::run)(unsigned short*, const unsigned short*, size_t) =
+		HasAvx2() ? MaxVector16Avx2 : HasSse41() ? MaxVector16Sse41 : MaxVectorScalar<unsigned short>;
+template <>
+void (*const MaxVector<unsigned int>::run)(unsigned int*, const unsigned int*, size_t) =
+		HasAvx2() ? MaxVector32Avx2 : HasSse41() ? MaxVector32Sse41 : MaxVectorScalar<unsigned int>;
+
 }  // namespace
 
-void ThreadMapping::computeVectorClocks(const SimpleDirectedGraph& graph) {
+void ThreadMapping::updateClockSize() {
+	std::vector<int> thread_size(m_numThreads, 0);
+	int max_thread_size = 0;
+	for (size_t node_id = 0; node_id < m_nodeThread.size(); ++node_id) {
+		if (m_nodeThread[node_id] == -1) continue;
+		max_thread_size = std::max(max_thread_size, ++thread_size[m_nodeThread[node_id]]);
+	}
+	if (max_thread_size <= 0xff) {
+		m_clockSize = 1;
+	} else if (max_thread_size <= 0xffff) {
+		m_clockSize = 2;
+	} else {
+		m_clockSize = 4;
+	}
+}
+
+void ThreadMapping::computeVectorClocks(const DirectedGraphInterface& graph) {
 	printf("ThreadMapping: Computing vector clocks...\n");
 	int64 start_time = GetCurrentTimeMicros();
-	m_vectorClocks.assign(graph.numNodes(), std::vector<short>());
+	m_vectorClocks8.clear();
+	m_vectorClocks16.clear();
+	m_vectorClocks32.clear();
+	if (m_clockSize == 1) {
+		computeVectorClocks(graph, &m_vectorClocks8);
+	} else if (m_clockSize == 2) {
+		computeVectorClocks(graph, &m_vectorClocks16);
+	} else {
+		computeVectorClocks(graph, &m_vectorClocks32);
+	}
+	printf("ThreadMapping: Vector clocks done... (%lld ms, %d bit clocks)\n",
+			(GetCurrentTimeMicros() - start_time) / 1000, m_clockSize * 8);
+}
+
+template <class T>
+void ThreadMapping::computeVectorClocks(const DirectedGraphInterface& graph, std::vector<std::vector<T> >* clocks) const {
+	clocks->assign(graph.numNodes(), std::vector<T>());
 	for (int node_id = 0; node_id < graph.numNodes(); ++node_id) {
 		if (m_nodeThread[node_id] == -1) continue;
-		m_vectorClocks[node_id].assign(m_numThreads, 0);
-		const std::vector<int>& pred = graph.nodePredecessors(node_id);
+		std::vector<T>& clock = (*clocks)[node_id];
+		clock.assign(m_numThreads, 0);
+		NodeSpan pred = graph.predecessors(node_id);
 		for (size_t j = 0; j < pred.size(); ++j) {
-			maxVector(&m_vectorClocks[node_id], m_vectorClocks[pred[j]]);
+			const std::vector<T>& pred_clock = (*clocks)[pred[j]];
+			MaxVector<T>::run(clock.data(), pred_clock.data(), pred_clock.size());
 		}
-		m_vectorClocks[node_id][m_nodeThread[node_id]]++;
+		clock[m_nodeThread[node_id]]++;
 	}
-	printf("ThreadMapping: Vector clocks done... (%lld ms)\n", (GetCurrentTimeMicros() - start_time) / 1000);
 }
 
 bool ThreadMapping::areOrdered(int slice1, int slice2) const {
 	if (slice1 == slice2) return true;
 	if (slice2 < slice1) return false;
-	return m_vectorClocks[slice1][m_nodeThread[slice1]] <= m_vectorClocks[slice2][m_nodeThread[slice1]];
+	switch (m_clockSize) {
+	case 1: return areOrdered(m_vectorClocks8, slice1, slice2);
+	case 2: return areOrdered(m_vectorClocks16, slice1, slice2);
+	default: return areOrdered(m_vectorClocks32, slice1, slice2);
+	}
+}
+
+void ThreadMapping::saveToFile(FILE* f) const {
+	WriteValue(f, m_numThreads);
+	WriteVector(f, m_nodeThread);
+	WriteValue(f, m_clockSize);
+	switch (m_clockSize) {
+	case 1: WriteVectors(f, m_vectorClocks8); break;
+	case 2: WriteVectors(f, m_vectorClocks16); break;
+	default: WriteVectors(f, m_vectorClocks32); break;
+	}
+}
+
+bool ThreadMapping::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadValue(data, size, pos, &m_numThreads) ||
+			!ReadVector(data, size, pos, &m_nodeThread) ||
+			!ReadValue(data, size, pos, &m_clockSize)) return false;
+	switch (m_clockSize) {
+	case 1: return ReadVectors(data, size, pos, &m_vectorClocks8);
+	case 2: return ReadVectors(data, size, pos, &m_vectorClocks16);
+	case 4: return ReadVectors(data, size, pos, &m_vectorClocks32);
+	default: return false;
+	}
 }
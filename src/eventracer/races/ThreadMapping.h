@@ -17,6 +17,8 @@
 #ifndef THREADMAPPING_H_
 #define THREADMAPPING_H_
 
+#include <stddef.h>
+#include <stdio.h>
 #include <vector>
 #include "EventGraph.h"
 
@@ -24,25 +26,53 @@
 class ThreadMapping : public EventGraphInterface {
 public:
 	ThreadMapping();
-	void build(const SimpleDirectedGraph& graph);
+	// Maps the nodes to threads greedily, following the arcs from every unmapped node.
+	void build(const DirectedGraphInterface& graph);
+	// Maps the nodes to near the minimum number of threads. A maximum matching of the arcs
+	// (Hopcroft-Karp) gives the fewest threads that do not share nodes, then every thread
+	// is continued by a thread that starts at the nearest node its last node reaches.
+	void buildChainCover(const DirectedGraphInterface& graph);
 
-	void computeVectorClocks(const SimpleDirectedGraph& graph);
+	// Computes the vector clocks. A clock value is at most the number of nodes of a thread,
+	// so the clocks use the narrowest unsigned type that fits the longest thread.
+	void computeVectorClocks(const DirectedGraphInterface& graph);
 
 	int num_threads() const { return m_numThreads; }
+	// Returns the thread of a node, or -1 for deleted nodes.
+	int nodeThread(int node_id) const { return m_nodeThread[node_id]; }
+	// Size in bytes of a clock value, known once the threads are built.
+	int clockBytes() const { return m_clockSize; }
 
 	virtual bool areOrdered(int slice1, int slice2) const;
 
-//	const std::vector<int>& getClockForSlice(int slice) const {
-//		return m_vectorClocks[slice];
-//	}
+	// Saves the thread mapping with its vector clocks to a file.
+	void saveToFile(FILE* f) const;
+
+	// Loads the thread mapping from memory starting at data[*pos] and advances *pos past it.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
 
 private:
-	void assignNodesToThread(const SimpleDirectedGraph& graph, int startNode, int threadId);
+	void matchArcs(const DirectedGraphInterface& graph, std::vector<int>* next) const;
+	void linkChains(const DirectedGraphInterface& graph, std::vector<int>* next) const;
+	void assignNodesToThread(const DirectedGraphInterface& graph, int startNode, int threadId);
+	// Sets m_clockSize to the narrowest size that fits the longest thread.
+	void updateClockSize();
+	template <class T>
+	void computeVectorClocks(const DirectedGraphInterface& graph, std::vector<std::vector<T> >* clocks) const;
+	template <class T>
+	bool areOrdered(const std::vector<std::vector<T> >& clocks, int slice1, int slice2) const {
+		int thread = m_nodeThread[slice1];
+		return clocks[slice1][thread] <= clocks[slice2][thread];
+	}
 
 	std::vector<int> m_nodeThread;
 	int m_numThreads;
 
-	std::vector<std::vector<short> > m_vectorClocks;
+	// Size in bytes of a clock value. Only the clocks of that size are set.
+	int m_clockSize;
+	std::vector<std::vector<unsigned char> > m_vectorClocks8;
+	std::vector<std::vector<unsigned short> > m_vectorClocks16;
+	std::vector<std::vector<unsigned int> > m_vectorClocks32;
 };
 
 #endif /* THREADMAPPING_H_ */
@@ -0,0 +1,356 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+
+#include "BitClocks.h"
+#include "EventGraph.h"
+#include "ThreadMapping.h"
+#include "thread_pool.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+void expectTrue(bool condition, const char* what) {
+	if (!condition) {
+		fprintf(stderr, "Test failed: %s\n^^^ FAIL ^^^\n", what);
+		throw 0;
+	}
+}
+
+// The reference answers: whether a node reaches another over arcs to higher ids,
+// found by a depth first search from every node.
+class ReachabilityMatrix {
+public:
+	explicit ReachabilityMatrix(const DirectedGraphInterface& graph)
+		: m_numNodes(graph.numNodes()), m_words(m_numNodes / 32 + 1),
+		  m_reaches(static_cast<size_t>(m_numNodes) * m_words, 0) {
+		std::vector<int> stack;
+		for (int source = 0; source < m_numNodes; ++source) {
+			unsigned int* reached = &m_reaches[static_cast<size_t>(source) * m_words];
+			reached[source / 32] |= 1u << (source % 32);
+			stack.push_back(source);
+			while (!stack.empty()) {
+				int node = stack.back();
+				stack.pop_back();
+				NodeSpan successors = graph.successors(node);
+				for (size_t i = 0; i < successors.size(); ++i) {
+					int successor = successors[i];
+					if (successor <= node || (reached[successor / 32] >> (successor % 32)) & 1) continue;
+					reached[successor / 32] |= 1u << (successor % 32);
+					stack.push_back(successor);
+				}
+			}
+		}
+	}
+
+	bool reaches(int source, int target) const {
+		return (m_reaches[static_cast<size_t>(source) * m_words + target / 32] >> (target % 32)) & 1;
+	}
+
+private:
+	int m_numNodes;
+	int m_words;
+	std::vector<unsigned int> m_reaches;
+};
+
+// Checks the answers of a backend for every pair of nodes that are not deleted.
+void expectSameAnswers(const DirectedGraphInterface& graph, const ReachabilityMatrix& expected,
+		const EventGraphInterface& backend, const char* what) {
+	for (int i = 0; i < graph.numNodes(); ++i) {
+		if (graph.isNodeDeleted(i)) continue;
+		for (int j = 0; j < graph.numNodes(); ++j) {
+			if (graph.isNodeDeleted(j)) continue;
+			expectTrue(backend.areOrdered(i, j) == expected.reaches(i, j), what);
+		}
+	}
+}
+
+// Checks that the nodes of every thread are totally ordered, that every node that is
+// not deleted has a thread and that the vector clocks give the reference answers.
+void expectValidMapping(const SimpleDirectedGraph& graph, const ReachabilityMatrix& expected,
+		const ThreadMapping& mapping, const char* what) {
+	std::vector<int> last_node(mapping.num_threads(), -1);
+	for (int node = 0; node < graph.numNodes(); ++node) {
+		int thread = mapping.nodeThread(node);
+		if (graph.isNodeDeleted(node)) {
+			expectTrue(thread == -1, what);
+			continue;
+		}
+		expectTrue(thread >= 0 && thread < mapping.num_threads(), what);
+		// Ordering the consecutive nodes of a thread orders all of them.
+		if (last_node[thread] != -1) expectTrue(expected.reaches(last_node[thread], node), what);
+		last_node[thread] = node;
+	}
+	for (int thread = 0; thread < mapping.num_threads(); ++thread) {
+		expectTrue(last_node[thread] != -1, what);
+	}
+	expectSameAnswers(graph, expected, mapping, what);
+}
+
+// Builds both mappings of a graph, checks them and returns the number of threads of
+// the chain cover.
+int checkMappings(const SimpleDirectedGraph& graph, const char* name) {
+	ReachabilityMatrix expected(graph);
+	ThreadMapping greedy;
+	greedy.build(graph);
+	greedy.computeVectorClocks(graph);
+	ThreadMapping cover;
+	cover.buildChainCover(graph);
+	cover.computeVectorClocks(graph);
+
+	char what[128];
+	snprintf(what, sizeof(what), "%s: valid greedy mapping", name);
+	expectValidMapping(graph, expected, greedy, what);
+	snprintf(what, sizeof(what), "%s: valid chain cover", name);
+	expectValidMapping(graph, expected, cover, what);
+	printf("%s: %d threads, %d with the greedy mapping\n", name, cover.num_threads(), greedy.num_threads());
+	snprintf(what, sizeof(what), "%s: chain cover not larger than the greedy mapping", name);
+	expectTrue(cover.num_threads() <= greedy.num_threads(), what);
+	return cover.num_threads();
+}
+
+unsigned int nextRandom(unsigned int* state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 8;
+}
+
+void testChain() {
+	printf("Starting test testChain...\n");
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(5);
+	for (int i = 0; i + 1 < 5; ++i) graph.addArc(i, i + 1);
+	expectTrue(checkMappings(graph, "chain") == 1, "a chain is one thread");
+}
+
+void testGreedyIsNotMinimal() {
+	printf("Starting test testGreedyIsNotMinimal...\n");
+	// The greedy mapping follows 0 -> 2 -> 3 and leaves 1 and 4 in threads of their own,
+	// but 0 -> 4 and 1 -> 2 -> 3 are enough.
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(5);
+	graph.addArc(0, 2);
+	graph.addArc(0, 4);
+	graph.addArc(1, 2);
+	graph.addArc(2, 3);
+	expectTrue(checkMappings(graph, "greedy is not minimal") == 2, "two threads");
+}
+
+void testGrid() {
+	printf("Starting test testGrid...\n");
+	// Every node (r, c) has arcs to (r + 1, c) and (r, c + 1). The largest set of
+	// unordered nodes is a diagonal, so the fewest threads are the shorter side.
+	const int rows = 4, columns = 7;
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(rows * columns);
+	for (int r = 0; r < rows; ++r) {
+		for (int c = 0; c < columns; ++c) {
+			if (r + 1 < rows) graph.addArc(r * columns + c, (r + 1) * columns + c);
+			if (c + 1 < columns) graph.addArc(r * columns + c, r * columns + c + 1);
+		}
+	}
+	expectTrue(checkMappings(graph, "grid") == rows, "one thread per row");
+}
+
+void testArcsToLowerIds() {
+	printf("Starting test testArcsToLowerIds...\n");
+	// Arcs to lower ids do not order nodes, so they cannot be in a thread.
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(4);
+	graph.addArc(1, 0);
+	graph.addArc(3, 2);
+	graph.addArc(0, 3);
+	checkMappings(graph, "arcs to lower ids");
+}
+
+void testWalkAlongArcToLowerId() {
+	printf("Starting test testWalkAlongArcToLowerId...\n");
+	// The greedy walk from 0 reaches 2 and then has only the arc 2 -> 1. It used to
+	// follow it and put 0, 2 and 1 in one thread, which ordered 0 before 1.
+	SimpleDirectedGraph graph;
+	graph.createEmptyGraph(3);
+	graph.addArc(0, 2);
+	graph.addArc(2, 1);
+	ThreadMapping mapping;
+	mapping.build(graph);
+	mapping.computeVectorClocks(graph);
+	expectTrue(mapping.areOrdered(0, 2), "0 before 2");
+	expectTrue(!mapping.areOrdered(0, 1), "0 not before 1");
+	expectTrue(!mapping.areOrdered(1, 2) && !mapping.areOrdered(2, 1), "1 and 2 not ordered");
+	expectTrue(mapping.num_threads() == 2, "node 1 in a thread of its own");
+}
+
+void testRandomGraphs() {
+	printf("Starting test testRandomGraphs...\n");
+	unsigned int random = 1;
+	for (int n = 0; n < 8; ++n) {
+		int num_nodes = 20 + n * 15;
+		int span = 2 + n * 5;
+		SimpleDirectedGraph graph;
+		graph.createEmptyGraph(num_nodes);
+		for (int i = 1; i < num_nodes; ++i) {
+			int num_arcs = nextRandom(&random) % 3;
+			for (int k = 0; k < num_arcs; ++k) {
+				int j = i - 1 - static_cast<int>(nextRandom(&random) % span);
+				if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+			}
+		}
+		if (n % 2 == 1) graph.deleteNode(num_nodes / 2);
+		char name[64];
+		snprintf(name, sizeof(name), "random graph %d", n);
+		checkMappings(graph, name);
+	}
+}
+
+// Checks BitClocks built sequentially and level by level on a pool.
+void checkBitClocks(const SimpleDirectedGraph& graph, ThreadPool* pool, const char* name) {
+	ReachabilityMatrix expected(graph);
+	char what[128];
+	BitClocks clocks;
+	clocks.build(graph);
+	snprintf(what, sizeof(what), "%s: bit clocks", name);
+	expectSameAnswers(graph, expected, clocks, what);
+	BitClocks parallel_clocks;
+	parallel_clocks.build(graph, pool);
+	snprintf(what, sizeof(what), "%s: bit clocks built in parallel", name);
+	expectSameAnswers(graph, expected, parallel_clocks, what);
+	expectTrue(parallel_clocks.clocksSizeBytes() == clocks.clocksSizeBytes(), what);
+	printf("%s: %lld KB of clocks\n", name, clocks.clocksSizeBytes() / 1024);
+}
+
+void testBitClocksRows() {
+	printf("Starting test testBitClocksRows...\n");
+	ThreadPool pool(4);
+	unsigned int random = 5;
+	{
+		// Node 0 happens before nothing, so the long run of ones in the clocks of the
+		// chain after it starts at word 1, and ends where the clocks get sparser.
+		SimpleDirectedGraph graph;
+		graph.createEmptyGraph(3000);
+		for (int i = 2; i < 2000; ++i) graph.addArc(i - 1, i);
+		for (int i = 2000; i < 3000; ++i) {
+			graph.addArc(1 + nextRandom(&random) % 1999, i);
+			int j = i - 1 - static_cast<int>(nextRandom(&random) % 100);
+			if (!graph.hasArc(j, i)) graph.addArc(j, i);
+		}
+		checkBitClocks(graph, &pool, "runs of ones");
+	}
+	{
+		// Few nodes reach each node, so most rows store only their nonzero words.
+		SimpleDirectedGraph graph;
+		graph.createEmptyGraph(3000);
+		for (int i = 1; i < 3000; ++i) {
+			if (nextRandom(&random) % 2 != 0) continue;
+			int j = i - 1 - static_cast<int>(nextRandom(&random) % 3000);
+			if (j >= 0) graph.addArc(j, i);
+		}
+		for (int i = 4; i < 3000; i += 9) graph.deleteNode(i);
+		checkBitClocks(graph, &pool, "sparse rows");
+	}
+	{
+		// Levels of hundreds of nodes, which the pool computes in parallel.
+		SimpleDirectedGraph graph;
+		graph.createEmptyGraph(2000);
+		for (int i = 10; i < 2000; ++i) {
+			for (int a = 0; a < 2; ++a) {
+				int j = i - 1 - static_cast<int>(nextRandom(&random) % 400);
+				if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+			}
+		}
+		checkBitClocks(graph, &pool, "wide levels");
+	}
+}
+
+void testBitClocksColumns() {
+	printf("Starting test testBitClocksColumns...\n");
+	ThreadPool pool(4);
+	unsigned int random = 6;
+	for (int n = 0; n < 8; ++n) {
+		int num_nodes = 100 + n * 60;
+		SimpleDirectedGraph graph;
+		graph.createEmptyGraph(num_nodes);
+		for (int i = 1; i < num_nodes; ++i) {
+			int num_arcs = nextRandom(&random) % 3;
+			for (int k = 0; k < num_arcs; ++k) {
+				int j = i - 1 - static_cast<int>(nextRandom(&random) % (2 + n * 10));
+				if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+			}
+		}
+		for (int i = 3; i < num_nodes; i += 7 + n) graph.deleteNode(i);
+		ReachabilityMatrix expected(graph);
+		// No columns, every n-th node and most nodes, so that sources and targets are
+		// found with and without a column.
+		std::vector<int> columns;
+		for (int i = 0; i < num_nodes; ++i) {
+			if (n % 4 != 0 && nextRandom(&random) % 8 < static_cast<unsigned int>(n % 4 * 2)) columns.push_back(i);
+		}
+		char what[64];
+		BitClocks clocks;
+		clocks.build(graph, NULL, &columns);
+		snprintf(what, sizeof(what), "random graph %d with %d columns", n, static_cast<int>(columns.size()));
+		expectSameAnswers(graph, expected, clocks, what);
+		BitClocks parallel_clocks;
+		parallel_clocks.build(graph, &pool, &columns);
+		snprintf(what, sizeof(what), "random graph %d with %d columns, built in parallel", n,
+				static_cast<int>(columns.size()));
+		expectSameAnswers(graph, expected, parallel_clocks, what);
+	}
+}
+
+void testBitClocksInstructions() {
+	printf("Starting test testBitClocksInstructions...\n");
+	// From the narrowest to the widest, so that the widest the processor has stays
+	// selected.
+	const char* const instructions[] = { "sse2", "avx2", "avx512f" };
+	ThreadPool pool(4);
+	for (int k = 0; k < 3; ++k) {
+		if (!BitClocks::setOrRowInstructions(instructions[k])) {
+			printf("%s: not supported\n", instructions[k]);
+			continue;
+		}
+		unsigned int random = 1;
+		for (int n = 0; n < 4; ++n) {
+			// Rows of hundreds of words, with lengths that leave a remainder after every
+			// vector width.
+			int num_nodes = 500 + n * 333;
+			SimpleDirectedGraph graph;
+			graph.createEmptyGraph(num_nodes);
+			for (int i = 1; i < num_nodes; ++i) {
+				for (int a = 0; a < 2; ++a) {
+					int j = i - 1 - static_cast<int>(nextRandom(&random) % (5 + n * 20));
+					if (j >= 0 && !graph.hasArc(j, i)) graph.addArc(j, i);
+				}
+			}
+			char name[64];
+			snprintf(name, sizeof(name), "%s: random graph %d", instructions[k], n);
+			checkBitClocks(graph, &pool, name);
+		}
+	}
+}
+
+int main(void) {
+	testChain();
+	testGreedyIsNotMinimal();
+	testGrid();
+	testArcsToLowerIds();
+	testWalkAlongArcToLowerId();
+	testRandomGraphs();
+	testBitClocksRows();
+	testBitClocksColumns();
+	testBitClocksInstructions();
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -17,9 +17,16 @@
 #include "VarsInfo.h"
 
 #include "ActionLog.h"
+#include "BFSReachability.h"
 #include "BitClocks.h"
 #include "EventGraph.h"
+#include "FrozenGraph.h"
+#include "IntervalLabels.h"
+#include "LandmarkLabels.h"
 #include "ThreadMapping.h"
+#include "serialize.h"
+#include "stringprintf.h"
+#include "thread_pool.h"
 
 #include "gflags/gflags.h"
 
@@ -31,7 +38,15 @@
 
 DEFINE_string(graph_connectivity_algorithm, "CD",
 		"Graph connectivity algorithm. Can be one of CD - chain decomposition,"
-		"BVC - bit vector clocks, BFS - breadth first search.");
+		"BVC - bit vector clocks, BFS - breadth first search, GRAIL - interval labels,"
+		" PLL - pruned landmark labels.");
+DEFINE_int32(interval_labelings, 3, "Number of interval labelings for --graph_connectivity_algorithm=GRAIL.");
+DEFINE_bool(minimum_chain_cover, false, "For chain decomposition, compute a chain cover "
+		"with near the minimum number of chains instead of the greedy one.");
+DEFINE_bool(bit_clocks_racy_events_only, true, "Give bits in the bit vector clocks "
+		"only to the event actions that access variables that may race.");
+DEFINE_bool(transitive_reduction, true, "Remove the arcs implied by other paths "
+		"before building the graph connectivity algorithm.");
 DEFINE_int64(race_detection_timeout_seconds, 0, "If the timeout is set to a "
 		"positive integer, race detection algorithms fail if computation takes"
 		" more than the specified number of seconds.");
@@ -116,6 +131,15 @@ public:
 		return false;
 	}
 
+	void saveToFile(FILE* f) const {
+		WriteVectors(f, m_topGraph);
+	}
+
+	// The top races are computed from the races, only the graph between them is loaded.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos) {
+		return ReadVectors(data, size, pos, &m_topGraph) && m_topGraph.size() == m_topRaces.size();
+	}
+
 private:
 	void initTopRaces() {
 		for (size_t i = 0; i < m_races.size(); ++i) {
@@ -151,7 +175,7 @@ private:
 
 
 VarsInfo::VarsInfo() : m_startTime(0), m_timedOut(false), m_timeToFindRacesMs(0), m_numChains(0),
-	m_fastEventGraph(NULL), m_raceGraph(NULL) {
+	m_fastEventGraphType(NO_FAST_EVENT_GRAPH), m_fastEventGraph(NULL), m_raceGraph(NULL) {
 }
 
 VarsInfo::~VarsInfo() {
@@ -161,23 +185,25 @@ VarsInfo::~VarsInfo() {
 
 void VarsInfo::init(const ActionLog& actions) {
 	for (int opid = 0; opid <= actions.maxEventActionId(); ++opid) {
-		std::map<int, VarAccess> per_var_accesses;
-		const ActionLog::EventAction& op = actions.event_action(opid);
-		for (size_t cmdid = 0; cmdid < op.m_commands.size(); ++cmdid) {
-			const ActionLog::Command& cmd = op.m_commands[cmdid];
-			if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
-				VarAccess a;
-				a.m_eventActionId = opid;
-				a.m_commandIdInEvent = cmdid;
-				a.m_isRead = false;
-				m_vars[cmd.m_location].m_accesses.push_back(a);
-			} else if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
-				VarAccess a;
-				a.m_eventActionId = opid;
-				a.m_commandIdInEvent = cmdid;
-				a.m_isRead = true;
-				m_vars[cmd.m_location].m_accesses.push_back(a);
-			}
+		addEventActionAccesses(opid, actions.event_action(opid));
+	}
+}
+
+void VarsInfo::addEventActionAccesses(int opid, const ActionLog::EventAction& op) {
+	for (size_t cmdid = 0; cmdid < op.m_commands.size(); ++cmdid) {
+		const ActionLog::Command& cmd = op.m_commands[cmdid];
+		if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
+			VarAccess a;
+			a.m_eventActionId = opid;
+			a.m_commandIdInEvent = cmdid;
+			a.m_isRead = false;
+			m_vars[cmd.m_location].m_accesses.push_back(a);
+		} else if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
+			VarAccess a;
+			a.m_eventActionId = opid;
+			a.m_commandIdInEvent = cmdid;
+			a.m_isRead = true;
+			m_vars[cmd.m_location].m_accesses.push_back(a);
 		}
 	}
 }
@@ -210,17 +236,28 @@ int VarsInfo::calculateFastTrackNumVCs() {
 	return num_allocated_vc;
 }
 
-void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& graph) {
+void VarsInfo::findRaces(const SimpleDirectedGraph& graph) {
 	m_races.clear();
 
 
+	// The graph does not change from here on, so the analyses read a compact copy.
 	m_numNodes = 0;
 	m_numArcs = 0;
 	for (int i = 0; i < graph.numNodes(); ++i) {
-		m_numArcs += graph.nodeSuccessors(i).size();
-		if (!graph.nodeSuccessors(i).empty() && !graph.nodePredecessors(i).empty()) {
+		if (!graph.successors(i).empty() && !graph.predecessors(i).empty()) {
 			++m_numNodes;
 		}
+		m_numArcs += graph.successors(i).size();
+	}
+	FrozenGraph frozen_graph;
+	int num_removed_arcs = 0;
+	int64 reduction_time = 0;
+	if (FLAGS_transitive_reduction) {
+		reduction_time = GetCurrentTimeMicros();
+		num_removed_arcs = frozen_graph.buildTransitiveReduction(graph);
+		reduction_time = GetCurrentTimeMicros() - reduction_time;
+	} else {
+		frozen_graph.build(graph);
 	}
 
 	m_startTime = GetCurrentTimeMicros();
@@ -228,28 +265,80 @@ void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& gr
 	if (FLAGS_graph_connectivity_algorithm == "CD") {
 		// Use vector clocks with chain decomposition.
 		ThreadMapping* tmp = new ThreadMapping();
-		tmp->build(graph);
+		if (FLAGS_minimum_chain_cover) {
+			// Report the greedy chains for comparison.
+			ThreadMapping greedy;
+			greedy.build(frozen_graph);
+			tmp->buildChainCover(frozen_graph);
+			printf("ThreadMapping: %d threads (%lld KB of clocks), %d with the greedy mapping (%lld KB)\n",
+					tmp->num_threads(),
+					static_cast<int64>(frozen_graph.numNodes()) * tmp->num_threads() * tmp->clockBytes() / 1024,
+					greedy.num_threads(),
+					static_cast<int64>(frozen_graph.numNodes()) * greedy.num_threads() * greedy.clockBytes() / 1024);
+		} else {
+			tmp->build(frozen_graph);
+		}
 
-		tmp->computeVectorClocks(graph);
+		tmp->computeVectorClocks(frozen_graph);
 		m_fastEventGraph = tmp;
+		m_fastEventGraphType = THREAD_MAPPING;
 
 		// Update statistics.
 		m_numChains = tmp->num_threads();
 	} else if (FLAGS_graph_connectivity_algorithm == "BFS") {
 		// Use breadth-first search for connectivity algorithm.
 
-		SimpleDirectedGraph* tmp = new SimpleDirectedGraph();
-		*tmp = graph;
+		BFSReachability* tmp = new BFSReachability();
+		tmp->build(frozen_graph);
 		m_fastEventGraph = tmp;
+		m_fastEventGraphType = BFS_REACHABILITY;
 	} else if (FLAGS_graph_connectivity_algorithm == "BVC") {
-		// Use bit vector clocks connectivity algorithm.
+		// Use bit vector clocks connectivity algorithm, built on all processors.
 
+		ThreadPool pool;
 		BitClocks* tmp = new BitClocks();
-		tmp->build(graph);
+		if (FLAGS_bit_clocks_racy_events_only) {
+			// Race detection only queries the accesses to variables that may race.
+			std::vector<int> racy_events;
+			for (AllVarData::const_iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+				const VarData& data = it->second;
+				int num_writes = data.numWrites();
+				if (!(num_writes >= 2 || (num_writes >= 1 && data.numReads() >= 1))) continue;
+				for (size_t i = 0; i < data.m_accesses.size(); ++i) {
+					racy_events.push_back(data.m_accesses[i].m_eventActionId);
+				}
+			}
+			std::sort(racy_events.begin(), racy_events.end());
+			racy_events.erase(std::unique(racy_events.begin(), racy_events.end()), racy_events.end());
+			tmp->build(frozen_graph, &pool, &racy_events);
+		} else {
+			tmp->build(frozen_graph, &pool);
+		}
+		m_fastEventGraph = tmp;
+		m_fastEventGraphType = BIT_CLOCKS;
+	} else if (FLAGS_graph_connectivity_algorithm == "GRAIL") {
+		// Use interval labels with a search for the pairs they do not decide.
+
+		IntervalLabels* tmp = new IntervalLabels();
+		tmp->build(frozen_graph, FLAGS_interval_labelings);
 		m_fastEventGraph = tmp;
+		m_fastEventGraphType = INTERVAL_LABELS;
+	} else if (FLAGS_graph_connectivity_algorithm == "PLL") {
+		// Use landmark labels, built on all processors.
+
+		ThreadPool pool;
+		LandmarkLabels* tmp = new LandmarkLabels();
+		tmp->build(frozen_graph, &pool);
+		m_fastEventGraph = tmp;
+		m_fastEventGraphType = LANDMARK_LABELS;
 	}
 	// Record how much time we needed for the connectivity algorithm initialization.
 	m_initTime = (GetCurrentTimeMicros() - m_startTime) / 1000;
+	if (FLAGS_transitive_reduction) {
+		printf("Transitive reduction removed %d of %d arcs (%lld ms), then %s took %d ms to build.\n",
+				num_removed_arcs, m_numArcs, reduction_time / 1000,
+				FLAGS_graph_connectivity_algorithm.c_str(), m_initTime);
+	}
 
 
 	int vars_ww = 0, vars_rw = 0, vars_wr = 0;
@@ -335,9 +424,14 @@ void VarsInfo::findRaces(const ActionLog& actions, const SimpleDirectedGraph& gr
 	}
 
 	printf("Has %d vars with WW races, %d with RW and %d with WR.\n", vars_ww, vars_rw, vars_wr);
-	findRaceDependency(actions);
+	findRaceDependency();
 
 	m_timeToFindRacesMs = (GetCurrentTimeMicros() - m_startTime) / 1000;
+	if (m_fastEventGraphType == BFS_REACHABILITY) {
+		static_cast<const BFSReachability*>(m_fastEventGraph)->printStats();
+	} else if (m_fastEventGraphType == INTERVAL_LABELS) {
+		static_cast<const IntervalLabels*>(m_fastEventGraph)->printStats();
+	}
 }
 
 class Op2IsAfter {
@@ -406,7 +500,7 @@ void VarsInfo::sortRaces() {
 	}
 }
 
-void VarsInfo::findRaceDependency(const ActionLog& actions) {
+void VarsInfo::findRaceDependency() {
 	printf("Searching for race dependency...\n");
 	sortRaces();
 
@@ -436,7 +530,7 @@ void VarsInfo::findRaceDependency(const ActionLog& actions) {
 	}
 
 	printf("Searching for multi-race dependency...\n");
-	findMultiRaceDependency(actions);
+	findMultiRaceDependency();
 }
 
 void VarsInfo::getDirectRaceChildren(int race_id, bool only_different_event_actions, std::set<int>* direct_child_races) const {
@@ -479,7 +573,7 @@ bool VarsInfo::hasPathViaRaces(int node1, int node2, int cmd_in_node2,
 	return m_raceGraph->hasPathViaRaces(node1, node2, cmd_in_node2, race_path);
 }
 
-void VarsInfo::findMultiRaceDependency(const ActionLog& actions) {
+void VarsInfo::findMultiRaceDependency() {
 	delete m_raceGraph;
 	m_raceGraph = new RaceGraph(*this, *m_fastEventGraph);
 	m_raceGraph->buildTopGraph();
@@ -498,6 +592,184 @@ void VarsInfo::findMultiRaceDependency(const ActionLog& actions) {
 	}
 }
 
+void VarsInfo::saveToFile(FILE* f) const {
+	WriteValue(f, m_timedOut);
+	WriteValue(f, m_timeToFindRacesMs);
+	WriteValue(f, m_initTime);
+	WriteValue(f, m_numChains);
+	WriteValue(f, m_numNodes);
+	WriteValue(f, m_numArcs);
+
+	WriteValue(f, static_cast<int>(m_vars.size()));
+	for (AllVarData::const_iterator it = m_vars.begin(); it != m_vars.end(); ++it) {
+		const VarData& var = it->second;
+		WriteValue(f, it->first);
+		WriteVector(f, var.m_accesses);
+		WriteValue(f, var.m_numWWRaces);
+		WriteValue(f, var.m_numWRRaces);
+		WriteValue(f, var.m_numRWRaces);
+		WriteVector(f, var.m_childRaces);
+		WriteVector(f, var.m_parentRaces);
+		WriteVector(f, var.m_noParentRaces);
+		WriteVector(f, var.m_allRaces);
+	}
+
+	WriteValue(f, static_cast<int>(m_races.size()));
+	for (size_t i = 0; i < m_races.size(); ++i) {
+		const RaceInfo& race = m_races[i];
+		WriteValue(f, static_cast<int>(race.m_access1));
+		WriteValue(f, static_cast<int>(race.m_access2));
+		WriteValue(f, race.m_event1);
+		WriteValue(f, race.m_event2);
+		WriteValue(f, race.m_cmdInEvent1);
+		WriteValue(f, race.m_cmdInEvent2);
+		WriteValue(f, race.m_varId);
+		WriteValue(f, race.m_coveredBy);
+		WriteVector(f, race.m_childRaces);
+		WriteVector(f, race.m_multiParentRaces);
+	}
+
+	WriteValue(f, static_cast<int>(m_fastEventGraphType));
+	switch (m_fastEventGraphType) {
+	case NO_FAST_EVENT_GRAPH: break;
+	case THREAD_MAPPING: static_cast<const ThreadMapping*>(m_fastEventGraph)->saveToFile(f); break;
+	case BFS_REACHABILITY: static_cast<const BFSReachability*>(m_fastEventGraph)->saveToFile(f); break;
+	case BIT_CLOCKS: static_cast<const BitClocks*>(m_fastEventGraph)->saveToFile(f); break;
+	case INTERVAL_LABELS: static_cast<const IntervalLabels*>(m_fastEventGraph)->saveToFile(f); break;
+	case LANDMARK_LABELS: static_cast<const LandmarkLabels*>(m_fastEventGraph)->saveToFile(f); break;
+	}
+
+	WriteValue(f, m_raceGraph != NULL);
+	if (m_raceGraph != NULL) {
+		m_raceGraph->saveToFile(f);
+	}
+}
+
+bool VarsInfo::loadFromMemory(const char* data, size_t size, size_t* pos) {
+	clear();
+	if (readFromMemory(data, size, pos)) return true;
+	clear();
+	return false;
+}
+
+void VarsInfo::clear() {
+	m_timedOut = false;
+	m_vars.clear();
+	m_races.clear();
+	m_fastEventGraphType = NO_FAST_EVENT_GRAPH;
+	delete m_fastEventGraph;
+	m_fastEventGraph = NULL;
+	delete m_raceGraph;
+	m_raceGraph = NULL;
+}
+
+bool VarsInfo::readFromMemory(const char* data, size_t size, size_t* pos) {
+	if (!ReadValue(data, size, pos, &m_timedOut) ||
+			!ReadValue(data, size, pos, &m_timeToFindRacesMs) ||
+			!ReadValue(data, size, pos, &m_initTime) ||
+			!ReadValue(data, size, pos, &m_numChains) ||
+			!ReadValue(data, size, pos, &m_numNodes) ||
+			!ReadValue(data, size, pos, &m_numArcs)) return false;
+
+	int num_vars;
+	if (!ReadValue(data, size, pos, &num_vars)) return false;
+	for (int i = 0; i < num_vars; ++i) {
+		int var_id;
+		if (!ReadValue(data, size, pos, &var_id)) return false;
+		VarData& var = m_vars[var_id];
+		if (!ReadVector(data, size, pos, &var.m_accesses) ||
+				!ReadValue(data, size, pos, &var.m_numWWRaces) ||
+				!ReadValue(data, size, pos, &var.m_numWRRaces) ||
+				!ReadValue(data, size, pos, &var.m_numRWRaces) ||
+				!ReadVector(data, size, pos, &var.m_childRaces) ||
+				!ReadVector(data, size, pos, &var.m_parentRaces) ||
+				!ReadVector(data, size, pos, &var.m_noParentRaces) ||
+				!ReadVector(data, size, pos, &var.m_allRaces)) return false;
+	}
+
+	int num_races;
+	if (!ReadValue(data, size, pos, &num_races) || num_races < 0) return false;
+	m_races.reserve(num_races);
+	for (int i = 0; i < num_races; ++i) {
+		int access1, access2, event1, event2, cmd1, cmd2, var_id;
+		if (!ReadValue(data, size, pos, &access1) ||
+				!ReadValue(data, size, pos, &access2) ||
+				!ReadValue(data, size, pos, &event1) ||
+				!ReadValue(data, size, pos, &event2) ||
+				!ReadValue(data, size, pos, &cmd1) ||
+				!ReadValue(data, size, pos, &cmd2) ||
+				!ReadValue(data, size, pos, &var_id)) return false;
+		m_races.push_back(RaceInfo(static_cast<VarAccessType>(access1), static_cast<VarAccessType>(access2),
+				event1, event2, cmd1, cmd2, var_id));
+		RaceInfo& race = m_races.back();
+		if (!ReadValue(data, size, pos, &race.m_coveredBy) ||
+				!ReadVector(data, size, pos, &race.m_childRaces) ||
+				!ReadVector(data, size, pos, &race.m_multiParentRaces)) return false;
+	}
+
+	int type;
+	if (!ReadValue(data, size, pos, &type)) return false;
+	m_fastEventGraphType = static_cast<FastEventGraphType>(type);
+	switch (m_fastEventGraphType) {
+	case NO_FAST_EVENT_GRAPH:
+		break;
+	case THREAD_MAPPING: {
+		ThreadMapping* tmp = new ThreadMapping();
+		m_fastEventGraph = tmp;
+		if (!tmp->loadFromMemory(data, size, pos)) return false;
+		break;
+	}
+	case BFS_REACHABILITY: {
+		BFSReachability* tmp = new BFSReachability();
+		m_fastEventGraph = tmp;
+		if (!tmp->loadFromMemory(data, size, pos)) return false;
+		break;
+	}
+	case BIT_CLOCKS: {
+		BitClocks* tmp = new BitClocks();
+		m_fastEventGraph = tmp;
+		if (!tmp->loadFromMemory(data, size, pos)) return false;
+		break;
+	}
+	case INTERVAL_LABELS: {
+		IntervalLabels* tmp = new IntervalLabels();
+		m_fastEventGraph = tmp;
+		if (!tmp->loadFromMemory(data, size, pos)) return false;
+		break;
+	}
+	case LANDMARK_LABELS: {
+		LandmarkLabels* tmp = new LandmarkLabels();
+		m_fastEventGraph = tmp;
+		if (!tmp->loadFromMemory(data, size, pos)) return false;
+		break;
+	}
+	default:
+		return false;
+	}
+
+	bool has_race_graph;
+	if (!ReadValue(data, size, pos, &has_race_graph)) return false;
+	if (has_race_graph) {
+		if (m_fastEventGraph == NULL) return false;
+		m_raceGraph = new RaceGraph(*this, *m_fastEventGraph);
+		if (!m_raceGraph->loadFromMemory(data, size, pos)) return false;
+	}
+	return true;
+}
+
+std::string VarsInfo::analysisOptions() {
+	// Every flag that changes the results of findRaces or what saveToFile stores must be
+	// here, so that a snapshot made with other values is not used. The timeout does not
+	// matter, results that timed out are not saved.
+	std::string options = StringPrintf("graph_connectivity_algorithm=%s",
+			FLAGS_graph_connectivity_algorithm.c_str());
+	StringAppendF(&options, " interval_labelings=%d", FLAGS_interval_labelings);
+	StringAppendF(&options, " transitive_reduction=%d", FLAGS_transitive_reduction);
+	StringAppendF(&options, " bit_clocks_racy_events_only=%d", FLAGS_bit_clocks_racy_events_only);
+	StringAppendF(&options, " minimum_chain_cover=%d", FLAGS_minimum_chain_cover);
+	return options;
+}
+
 const char* VarsInfo::RaceInfo::TypeStr() const {
 	switch (m_access1) {
 	case MEMORY_READ: {
@@ -19,11 +19,14 @@
 
 #include "base.h"
 #include <stddef.h>
+#include <stdio.h>
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
-class ActionLog;
+#include "ActionLog.h"
+
 class SimpleDirectedGraph;
 class EventGraphInterface;
 
@@ -36,7 +39,11 @@ public:
 
 	void init(const ActionLog& actions);
 
-	void findRaces(const ActionLog& actions, const SimpleDirectedGraph& graph);
+	// Adds the variable accesses of one event action. Event actions must be added in
+	// increasing order of their ids.
+	void addEventActionAccesses(int event_action_id, const ActionLog::EventAction& op);
+
+	void findRaces(const SimpleDirectedGraph& graph);
 
 	// Calculates the number of variables, for which FastTrack would need to allocate vector clocks.
 	int calculateFastTrackNumVCs();
@@ -252,16 +259,41 @@ public:
 	bool hasPathViaRaces(int node1, int node2, int cmd_in_node2,
 			std::vector<int>* race_path) const;
 
+	// Saves the results of findRaces to a file: the variables, the races with their
+	// coverage, the statistics and the graph used for connectivity queries.
+	void saveToFile(FILE* f) const;
+
+	// Loads the results of findRaces from memory starting at data[*pos] and advances *pos past them.
+	bool loadFromMemory(const char* data, size_t size, size_t* pos);
+
+	// Returns a description of the flags that affect the results of findRaces or the
+	// saved index. Snapshots are only used with the same description.
+	static std::string analysisOptions();
+
 private:
+	// The type of m_fastEventGraph.
+	enum FastEventGraphType {
+		NO_FAST_EVENT_GRAPH,
+		THREAD_MAPPING,
+		BFS_REACHABILITY,
+		BIT_CLOCKS,
+		INTERVAL_LABELS,
+		LANDMARK_LABELS
+	};
+
 	// Returns true if a computation timed out and sets the m_timedOut variable to true.
 	bool shouldTimeout();
 
 	void sortRaces();
 
-	void findRaceDependency(const ActionLog& actions);
+	// Removes the variables and the results of findRaces.
+	void clear();
+	bool readFromMemory(const char* data, size_t size, size_t* pos);
+
+	void findRaceDependency();
 
 	// Races must be sorted before calling this.
-	void findMultiRaceDependency(const ActionLog& actions);
+	void findMultiRaceDependency();
 
 	int64 m_startTime;
 	bool m_timedOut;
@@ -274,8 +306,22 @@ private:
 	AllVarData m_vars;
 	AllRaces m_races;
 
+	FastEventGraphType m_fastEventGraphType;
 	EventGraphInterface* m_fastEventGraph;
 	RaceGraph* m_raceGraph;
 };
 
+// Collects the variable accesses of a streamed action log.
+class VarAccessCollector : public ActionLogConsumer {
+public:
+	explicit VarAccessCollector(VarsInfo* vinfo) : m_vinfo(vinfo) {}
+
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) {
+		m_vinfo->addEventActionAccesses(event_action_id, event_action);
+	}
+
+private:
+	VarsInfo* m_vinfo;
+};
+
 #endif /* VARSINFO_H_ */
@@ -0,0 +1,173 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Compares the compressed clocks of BitClocks with dense clocks of one bit per node:
+// the time to build them, their size and the time of areOrdered queries. The graph
+// is the event graph of an ER_actionlog file with the timer arcs, or a generated one.
+
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "ActionLogStream.h"
+#include "BitClocks.h"
+#include "EventGraph.h"
+#include "EventGraphBuilder.h"
+#include "StringSet.h"
+#include "TimerGraph.h"
+#include "base.h"
+#include "thread_pool.h"
+
+DEFINE_int32(rounds, 5, "Number of times to repeat the queries.");
+DEFINE_int32(queries, 2000000, "Number of random pairs of nodes to query.");
+DEFINE_int32(nodes, 20000, "Number of nodes of the generated graph, used without a file.");
+DEFINE_int32(arc_span, 1000, "The generated graph has a path through all nodes and two "
+		"more arcs into every node, each from one of this many nodes before it.");
+
+namespace {
+
+unsigned int NextRandom(unsigned int* state) {
+	*state = *state * 1103515245 + 12345;
+	return *state >> 8;
+}
+
+void GenerateGraph(SimpleDirectedGraph* graph) {
+	graph->createEmptyGraph(FLAGS_nodes);
+	unsigned int random = 1;
+	for (int i = 1; i < FLAGS_nodes; ++i) {
+		graph->addArc(i - 1, i);
+		for (int k = 0; k < 2; ++k) {
+			int j = i - 1 - static_cast<int>(NextRandom(&random) % FLAGS_arc_span);
+			if (j >= 0) graph->addArc(j, i);
+		}
+	}
+}
+
+// The clocks BitClocks had before they were compressed: for every node, one bit for
+// each node up to it.
+class DenseBitClocks {
+public:
+	void build(const DirectedGraphInterface& graph) {
+		int num_nodes = graph.numNodes();
+		m_words = num_nodes / 32 + 1;
+		m_bits.assign(static_cast<size_t>(num_nodes) * m_words, 0);
+		for (int node = 0; node < num_nodes; ++node) {
+			unsigned int* clock = &m_bits[static_cast<size_t>(node) * m_words];
+			NodeSpan predecessors = graph.predecessors(node);
+			for (size_t i = 0; i < predecessors.size(); ++i) {
+				int predecessor = predecessors[i];
+				if (predecessor >= node) continue;
+				const unsigned int* other = &m_bits[static_cast<size_t>(predecessor) * m_words];
+				for (int j = 0; j <= predecessor / 32; ++j) clock[j] |= other[j];
+			}
+			clock[node / 32] |= 1U << (node % 32);
+		}
+	}
+
+	bool areOrdered(int slice1, int slice2) const {
+		if (slice1 > slice2) return false;
+		return (m_bits[static_cast<size_t>(slice2) * m_words + slice1 / 32] >> (slice1 % 32)) & 1;
+	}
+
+	int64 sizeBytes() const { return static_cast<int64>(m_bits.size()) * sizeof(unsigned int); }
+
+private:
+	int m_words;
+	std::vector<unsigned int> m_bits;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [<ER_actionlog>]\n", argv[0]);
+		return 1;
+	}
+
+	SimpleDirectedGraph graph;
+	if (argc == 2) {
+		StringSet vars, scopes, js, mem_values;
+		SimpleDirectedGraph event_graph;
+		EventGraphBuilder graph_builder(&event_graph);
+		ActionLogStream stream;
+		stream.addConsumer(&graph_builder);
+		if (!stream.run(argv[1], &vars, &scopes, &js, &mem_values)) {
+			fprintf(stderr, "Cannot read %s\n", argv[1]);
+			return 1;
+		}
+		graph = event_graph;
+		TimerGraph timer_graph(graph_builder.arcs(), graph);
+		timer_graph.build(&graph);
+	} else {
+		GenerateGraph(&graph);
+	}
+	int num_nodes = graph.numNodes();
+	printf("%d nodes\n", num_nodes);
+	if (num_nodes == 0) return 0;
+
+	int64 start_time = GetCurrentTimeMicros();
+	DenseBitClocks dense;
+	dense.build(graph);
+	int64 dense_build_time = GetCurrentTimeMicros() - start_time;
+
+	start_time = GetCurrentTimeMicros();
+	ThreadPool pool;
+	BitClocks compressed;
+	compressed.build(graph, &pool);
+	int64 compressed_build_time = GetCurrentTimeMicros() - start_time;
+
+	std::vector<std::pair<int, int> > queries(FLAGS_queries);
+	unsigned int random = 2;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		int a = NextRandom(&random) % num_nodes;
+		int b = NextRandom(&random) % num_nodes;
+		queries[i] = a < b ? std::make_pair(a, b) : std::make_pair(b, a);
+	}
+	int num_ordered = 0, num_different = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		bool ordered = dense.areOrdered(queries[i].first, queries[i].second);
+		if (ordered) ++num_ordered;
+		if (ordered != compressed.areOrdered(queries[i].first, queries[i].second)) ++num_different;
+	}
+	printf("%d of %d queried pairs are ordered, %d answered differently\n",
+			num_ordered, static_cast<int>(queries.size()), num_different);
+
+	int64 dense_time = 0, compressed_time = 0;
+	int checksum = 0;
+	for (int round = 0; round < FLAGS_rounds; ++round) {
+		start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < queries.size(); ++i) {
+			checksum += dense.areOrdered(queries[i].first, queries[i].second);
+		}
+		dense_time += GetCurrentTimeMicros() - start_time;
+		start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < queries.size(); ++i) {
+			checksum += compressed.areOrdered(queries[i].first, queries[i].second);
+		}
+		compressed_time += GetCurrentTimeMicros() - start_time;
+	}
+	double n = static_cast<double>(queries.size()) * FLAGS_rounds;
+	if (n == 0) return 0;
+	printf("  dense       build %6lld ms, %8lld KB, %6.1f ns/query\n",
+			dense_build_time / 1000, dense.sizeBytes() / 1024, dense_time * 1000.0 / n);
+	printf("  compressed  build %6lld ms, %8lld KB, %6.1f ns/query\n",
+			compressed_build_time / 1000, compressed.clocksSizeBytes() / 1024, compressed_time * 1000.0 / n);
+	printf("  (checksum %d)\n", checksum);
+	return 0;
+}
@@ -0,0 +1,56 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Converts an ER_actionlog file of any version to the current version.
+
+#include <stdio.h>
+
+#include "gflags/gflags.h"
+
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+#include "StringSet.h"
+#include "thread_pool.h"
+
+DEFINE_bool(compact, false, "Store the commands in the compact encoding.");
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <input ER_actionlog> <output ER_actionlog>\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, scopes, js, mem_values;
+	ActionLog actions;
+	ActionLogFile in;
+	ThreadPool pool;
+	if (!in.open(argv[1]) || !in.load(&vars, &scopes, &actions, &js, &mem_values, &pool)) {
+		fprintf(stderr, "Cannot read %s\n", argv[1]);
+		return 1;
+	}
+	printf("Read %s (version %d)\n", argv[1], in.version());
+
+	if (!ActionLogFile::write(argv[2], &vars, &scopes, &actions,
+			in.hasSection(ActionLogFile::JS) ? &js : NULL,
+			in.hasSection(ActionLogFile::MEM_VALUES) ? &mem_values : NULL,
+			FLAGS_compact ? ActionLogFile::COMPACT : ActionLogFile::COLUMNS)) {
+		fprintf(stderr, "Cannot write %s\n", argv[2]);
+		return 1;
+	}
+	printf("Wrote %s\n", argv[2]);
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Merges several ER_actionlog files into one. The strings of all logs are joined and
+// the event action ids of every log are placed after the ones of the previous logs,
+// so logs of different sessions can be analyzed together. Shards written by splitlog
+// are merged back with --nooffset_event_ids.
+
+#include <stdio.h>
+
+#include "gflags/gflags.h"
+
+#include "ActionLog.h"
+#include "ActionLogCopier.h"
+#include "ActionLogFile.h"
+#include "StringSet.h"
+#include "thread_pool.h"
+
+DEFINE_bool(offset_event_ids, true,
+		"Place the event action ids of every log after the ones of the previous logs. "
+		"Otherwise the ids are kept and event actions with the same id are joined.");
+DEFINE_bool(compact, false, "Store the commands in the compact encoding.");
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <output ER_actionlog> <input ER_actionlog>...\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, scopes, js, mem_values;
+	ActionLog actions;
+	ActionLogCopier copier(&actions, &vars, &scopes, &js, &mem_values);
+	ThreadPool pool;
+	int offset = 0;
+	bool has_js = false, has_mem_values = false;
+	for (int i = 2; i < argc; ++i) {
+		StringSet in_vars, in_scopes, in_js, in_mem_values;
+		ActionLog in_actions;
+		ActionLogFile in;
+		if (!in.open(argv[i]) || !in.load(&in_vars, &in_scopes, &in_actions, &in_js, &in_mem_values, &pool)) {
+			fprintf(stderr, "Cannot read %s\n", argv[i]);
+			return 1;
+		}
+		has_js |= in.hasSection(ActionLogFile::JS);
+		has_mem_values |= in.hasSection(ActionLogFile::MEM_VALUES);
+
+		copier.setInput(&in_vars, &in_scopes, &in_js, &in_mem_values, offset);
+		for (size_t j = 0; j < in_actions.arcs().size(); ++j) {
+			copier.copyArc(in_actions.arcs()[j]);
+		}
+		for (int id = 0; id <= in_actions.maxEventActionId(); ++id) {
+			if (!in_actions.hasEventAction(id)) continue;
+			copier.copyEventAction(id, in_actions.event_action(id));
+		}
+		printf("Read %s: event actions %d-%d\n", argv[i], offset, offset + in_actions.maxEventActionId());
+		if (FLAGS_offset_event_ids) {
+			offset += in_actions.maxEventActionId() + 1;
+		}
+	}
+
+	if (!ActionLogFile::write(argv[1], &vars, &scopes, &actions,
+			has_js ? &js : NULL, has_mem_values ? &mem_values : NULL,
+			FLAGS_compact ? ActionLogFile::COMPACT : ActionLogFile::COLUMNS)) {
+		fprintf(stderr, "Cannot write %s\n", argv[1]);
+		return 1;
+	}
+	printf("Wrote %s: %d event actions, %d arcs\n", argv[1], actions.maxEventActionId() + 1,
+			static_cast<int>(actions.arcs().size()));
+	return 0;
+}
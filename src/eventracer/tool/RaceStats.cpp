@@ -26,12 +26,18 @@
 #include "string.h"
 #include "stringprintf.h"
 #include "strutil.h"
+#include "thread_pool.h"
 
 #include "ActionLog.h"
+#include "AnalysisSnapshot.h"
 #include "RaceTags.h"
 #include "GraphFix.h"
 #include "TimerGraph.h"
 
+#include "gflags/gflags.h"
+
+DECLARE_bool(erindex);
+
 using std::string;
 
 namespace {
@@ -64,25 +70,37 @@ bool RaceFile::Load(const std::string& filename, bool eval_race_detector_time) {
 		m_filename = m_filename.substr(pos + 4, m_filename.size() - pos - 4);
 	}
 	printf("Loading %s...\n", filename.c_str());
-	FILE* f = fopen(filename.c_str(), "rb");
-	if (!f) {
-		fprintf(stderr, "ERROR in fopen()\n");
+	if (!m_logFile.open(filename.c_str())) {
+		fprintf(stderr, "ERROR in open()\n");
 		return false;
 	}
-	bool result = true;
-	result &= m_vars.loadFromFile(f);
-	result &= m_scopes.loadFromFile(f);
-	result &= m_actions.loadFromFile(f);
-	if (!feof(f)) {
-		result &= m_js.loadFromFile(f);
-	}
-	if (!feof(f)) {
-		result &= m_memValues.loadFromFile(f);
+	// The race detector is timed by running it, so the snapshot is not used then.
+	bool use_snapshot = FLAGS_erindex && !eval_race_detector_time;
+	std::string snapshot_options = StringPrintf("racestats %s", VarsInfo::analysisOptions().c_str());
+	AnalysisSnapshot snapshot;
+	ThreadPool pool;
+	bool result;
+	if (use_snapshot && snapshot.open(filename, snapshot_options)) {
+		result = m_logFile.load(NULL, &m_scopes, NULL, NULL, &m_memValues, &pool);
+		if (snapshot.load(&pool, &m_actions, &m_vars, &m_inputEventGraph, &m_graphWithTimers, &m_vinfo)) {
+			m_fileSize = m_logFile.size();
+			printf("DONE\n");
+			m_graphInfo.init(m_actions);
+			for (int i = 0; i < m_inputEventGraph.numNodes(); ++i) {
+				if (m_inputEventGraph.isNodeDeleted(i)) m_graphInfo.dropNode(i);
+			}
+			m_eventCauseFinder.Init(m_actions, m_inputEventGraph);
+			m_timeToFindRacesMs = m_vinfo.timeToFindRacesMs();
+			m_timeToInitRaceFinderMs = m_vinfo.timeInitMs();
+			return result;
+		}
+		result &= m_logFile.load(&m_vars, NULL, &m_actions, NULL, NULL, &pool);
+	} else {
+		result = m_logFile.load(&m_vars, &m_scopes, &m_actions, NULL, &m_memValues, &pool);
 	}
 
-	m_fileSize = ftell(f);
+	m_fileSize = m_logFile.size();
 
-	fclose(f);
 	printf("DONE\n");
 
 	m_inputEventGraph.addNodesUpTo(m_actions.maxEventActionId());
@@ -118,8 +136,12 @@ bool RaceFile::Load(const std::string& filename, bool eval_race_detector_time) {
 
 	printf("Checking for races...\n");
 	int64 start_time = GetCurrentTimeMicros();
-	m_vinfo.findRaces(m_actions, m_graphWithTimers);
+	m_vinfo.findRaces(m_graphWithTimers);
 	printf("Done checking for races... %lld ms\n", (GetCurrentTimeMicros() - start_time) / 1000);
+	if (use_snapshot) {
+		AnalysisSnapshot::save(filename, snapshot_options, &m_actions, &m_vars,
+				m_inputEventGraph, m_graphWithTimers, m_vinfo);
+	}
 
 	if (eval_race_detector_time && !m_vinfo.timedOut()) {
 		int race_times[5];
@@ -129,7 +151,7 @@ bool RaceFile::Load(const std::string& filename, bool eval_race_detector_time) {
 		for (int i = 1; i < 5; ++i) {
 			VarsInfo vinfo1;
 			vinfo1.init(m_actions);
-			vinfo1.findRaces(m_actions, m_graphWithTimers);
+			vinfo1.findRaces(m_graphWithTimers);
 			race_times[i] = vinfo1.timeToFindRacesMs();
 			init_times[i] = vinfo1.timeInitMs();
 		}
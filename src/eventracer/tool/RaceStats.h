@@ -23,6 +23,7 @@
 #include "EventGraphInfo.h"
 #include "StringSet.h"
 #include "ActionLog.h"
+#include "ActionLogFile.h"
 #include "VarsInfo.h"
 #include "RaceTags.h"
 
@@ -54,10 +55,10 @@ private:
 	const char* getOpName(int var_id, int op_id) const;
 
 	std::string m_filename;
+	ActionLogFile m_logFile;
 	ActionLog m_actions;
 	StringSet m_vars;
 	StringSet m_scopes;
-	StringSet m_js;
 	StringSet m_memValues;
 	std::string m_fileId;
 	int64 m_fileSize;
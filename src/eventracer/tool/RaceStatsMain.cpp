@@ -39,6 +39,9 @@ int main(int argc, char* argv[]) {
 	std::vector<RaceFile*> files;
 	while ((entry = readdir(dp))) {
 		if (entry->d_type == DT_REG) {
+			std::string name(entry->d_name);
+			// Skip the analysis snapshots next to the logs.
+			if (name.find(".erindex") != std::string::npos) continue;
 			RaceFile* file = new RaceFile();
 			std::string filename = path + "/" + entry->d_name;
 			if (!file->Load(filename, false)) {
@@ -0,0 +1,180 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Measures the recording speed of ActionLog by replaying the event actions of an
+// ER_actionlog file through the same calls the instrumented browser makes.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "ActionLog.h"
+#include "ActionLogFile.h"
+#include "ActionLogRecorder.h"
+#include "ActionLogWriter.h"
+#include "StringSet.h"
+#include "base.h"
+
+DEFINE_int32(rounds, 5, "Number of times to repeat the recording.");
+DEFINE_int32(duplicates, 2,
+		"Number of times every read and write is logged. The browser logs the same access "
+		"many times in an event action and the log keeps only the first one.");
+DEFINE_int32(threads, 0,
+		"If positive, record through an ActionLogRecorder from this many threads, "
+		"each recording every n-th event action.");
+DEFINE_string(output, "", "If set, record through an ActionLogWriter to this file.");
+
+namespace {
+
+// Records the event actions first, first + step, ... of log. Recorder is ActionLog
+// or ActionLogRecorder::Thread.
+template<class Recorder>
+void Record(const ActionLog& log, int max_id, int first, int step, Recorder* out) {
+	if (first == 0) {
+		const std::vector<ActionLog::Arc>& arcs = log.arcs();
+		for (size_t i = 0; i < arcs.size(); ++i) {
+			out->addArc(arcs[i].m_tail, arcs[i].m_head, arcs[i].m_duration);
+		}
+	}
+	for (int id = first; id <= max_id; id += step) {
+		ActionLog::EventAction op = log.event_action(id);
+		if (op.m_type == ActionLog::UNKNOWN && op.m_commands.empty()) continue;
+		out->startEventAction(id);
+		out->setEventActionType(op.m_type);
+		const ActionLog::CommandSpan& cmds = op.m_commands;
+		for (size_t i = 0; i < cmds.size(); ++i) {
+			ActionLog::CommandType type = cmds.type(i);
+			out->logCommand(type, cmds.location(i));
+			if (type == ActionLog::READ_MEMORY || type == ActionLog::WRITE_MEMORY) {
+				for (int j = 1; j < FLAGS_duplicates; ++j) out->logCommand(type, cmds.location(i));
+			}
+		}
+		out->endEventAction();
+	}
+}
+
+struct RecordThread {
+	const ActionLog* m_log;
+	int m_maxId;
+	int m_first;
+	int m_step;
+	ActionLogRecorder::Thread* m_thread;
+};
+
+void* RecordThreadMain(void* arg) {
+	RecordThread* t = static_cast<RecordThread*>(arg);
+	Record(*t->m_log, t->m_maxId, t->m_first, t->m_step, t->m_thread);
+	return NULL;
+}
+
+void RecordInThreads(const ActionLog& log, int max_id, ActionLog* out) {
+	StringSet vars, scopes;
+	ActionLogRecorder recorder(&vars, &scopes, NULL, NULL);
+	std::vector<RecordThread> threads(FLAGS_threads);
+	std::vector<pthread_t> handles(FLAGS_threads);
+	for (int i = 0; i < FLAGS_threads; ++i) {
+		threads[i].m_log = &log;
+		threads[i].m_maxId = max_id;
+		threads[i].m_first = i;
+		threads[i].m_step = FLAGS_threads;
+		threads[i].m_thread = recorder.newThread();
+		pthread_create(&handles[i], NULL, RecordThreadMain, &threads[i]);
+	}
+	for (int i = 0; i < FLAGS_threads; ++i) {
+		pthread_join(handles[i], NULL);
+	}
+	recorder.flush(out);
+}
+
+// Returns the number of event actions with different commands.
+int Compare(const ActionLog& a, const ActionLog& b, int max_id) {
+	int diffs = 0;
+	for (int id = 0; id <= max_id; ++id) {
+		ActionLog::EventAction x = a.event_action(id);
+		ActionLog::EventAction y = b.event_action(id);
+		bool same = x.m_type == y.m_type && x.m_commands.size() == y.m_commands.size();
+		for (size_t i = 0; same && i < x.m_commands.size(); ++i) {
+			same = x.m_commands[i] == y.m_commands[i];
+		}
+		if (!same) ++diffs;
+	}
+	return diffs;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <ER_actionlog>\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, scopes, js, mem_values;
+	ActionLog log;
+	ActionLogFile file;
+	if (!file.open(argv[1]) || !file.load(&vars, &scopes, &log, &js, &mem_values)) {
+		fprintf(stderr, "Cannot read %s\n", argv[1]);
+		return 1;
+	}
+	int max_id = log.maxEventActionId();
+	int64 num_commands = 0;
+	for (int id = 0; id <= max_id; ++id) {
+		ActionLog::EventAction op = log.event_action(id);
+		for (size_t i = 0; i < op.m_commands.size(); ++i) {
+			ActionLog::CommandType type = op.m_commands.type(i);
+			bool access = type == ActionLog::READ_MEMORY || type == ActionLog::WRITE_MEMORY;
+			num_commands += access ? FLAGS_duplicates : 1;
+		}
+	}
+	printf("%d event actions, %lld logged commands\n", max_id + 1, static_cast<long long>(num_commands));
+
+	int64 record_time = 0;
+	for (int round = 0; round < FLAGS_rounds; ++round) {
+		ActionLog copy;
+		ActionLogWriter writer;
+		if (!FLAGS_output.empty()) {
+			if (!writer.open(FLAGS_output.c_str(), &vars, &scopes,
+					file.hasSection(ActionLogFile::JS) ? &js : NULL,
+					file.hasSection(ActionLogFile::MEM_VALUES) ? &mem_values : NULL)) {
+				fprintf(stderr, "Cannot write %s\n", FLAGS_output.c_str());
+				return 1;
+			}
+			copy.setWriter(&writer);
+		}
+		int64 start_time = GetCurrentTimeMicros();
+		if (FLAGS_threads > 0) {
+			RecordInThreads(log, max_id, &copy);
+		} else {
+			Record(log, max_id, 0, 1, &copy);
+		}
+		if (!FLAGS_output.empty() && !writer.close()) {
+			fprintf(stderr, "Cannot write %s\n", FLAGS_output.c_str());
+			return 1;
+		}
+		record_time += GetCurrentTimeMicros() - start_time;
+		if (round == 0 && FLAGS_output.empty()) {
+			printf("  recorded log differs in %d event actions\n", Compare(log, copy, max_id));
+		}
+	}
+	double n = static_cast<double>(num_commands) * FLAGS_rounds;
+	if (n == 0) return 0;
+	printf("  record  %8.1f ns/command, %.1f ms/round\n",
+			record_time * 1000.0 / n, record_time / 1000.0 / FLAGS_rounds);
+	return 0;
+}
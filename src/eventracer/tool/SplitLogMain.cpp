@@ -0,0 +1,118 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Splits an ER_actionlog into shards, each with a range of event action ids. A shard
+// has the event actions in its range, the arcs into them (also the ones from earlier
+// shards) and only the strings its commands use. mergelog --nooffset_event_ids joins
+// the shards again.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "ActionLog.h"
+#include "ActionLogCopier.h"
+#include "ActionLogFile.h"
+#include "StringSet.h"
+#include "stringprintf.h"
+#include "thread_pool.h"
+
+DEFINE_int32(shards, 4, "Number of shards. The ranges are chosen to have about the same number of commands.");
+DEFINE_bool(compact, false, "Store the commands in the compact encoding.");
+
+namespace {
+
+// Returns the first event action id of every shard, followed by the end of the last one.
+std::vector<int> ShardBoundaries(const ActionLog& actions, int num_shards) {
+	int num_ids = actions.maxEventActionId() + 1;
+	size_t total = 0;
+	for (int id = 0; id < num_ids; ++id) {
+		total += actions.event_action(id).m_commands.size() + 1;
+	}
+	std::vector<int> boundaries;
+	boundaries.push_back(0);
+	size_t sum = 0;
+	for (int id = 0; id < num_ids; ++id) {
+		sum += actions.event_action(id).m_commands.size() + 1;
+		if (static_cast<int>(boundaries.size()) < num_shards &&
+				sum * num_shards >= total * boundaries.size() && id + 1 < num_ids) {
+			boundaries.push_back(id + 1);
+		}
+	}
+	boundaries.push_back(num_ids);
+	return boundaries;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc != 3 || FLAGS_shards < 1) {
+		fprintf(stderr, "Usage: %s [--shards=N] <input ER_actionlog> <output prefix>\n"
+				"Writes the shards to <output prefix>.0, <output prefix>.1, ...\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, scopes, js, mem_values;
+	ActionLog actions;
+	ActionLogFile in;
+	ThreadPool pool;
+	if (!in.open(argv[1]) || !in.load(&vars, &scopes, &actions, &js, &mem_values, &pool)) {
+		fprintf(stderr, "Cannot read %s\n", argv[1]);
+		return 1;
+	}
+	bool has_js = in.hasSection(ActionLogFile::JS);
+	bool has_mem_values = in.hasSection(ActionLogFile::MEM_VALUES);
+
+	std::vector<int> boundaries = ShardBoundaries(actions, FLAGS_shards);
+	for (size_t shard = 0; shard + 1 < boundaries.size(); ++shard) {
+		int begin = boundaries[shard];
+		int end = boundaries[shard + 1];
+		StringSet out_vars, out_scopes, out_js, out_mem_values;
+		ActionLog out_actions;
+		ActionLogCopier copier(&out_actions, &out_vars, &out_scopes,
+				has_js ? &out_js : NULL, has_mem_values ? &out_mem_values : NULL);
+		copier.setInput(&vars, &scopes, &js, &mem_values, 0);
+		int num_arcs = 0;
+		for (size_t i = 0; i < actions.arcs().size(); ++i) {
+			const ActionLog::Arc& arc = actions.arcs()[i];
+			if (arc.m_head >= begin && arc.m_head < end) {
+				copier.copyArc(arc);
+				++num_arcs;
+			}
+		}
+		int num_event_actions = 0;
+		for (int id = begin; id < end; ++id) {
+			if (!actions.hasEventAction(id)) continue;
+			copier.copyEventAction(id, actions.event_action(id));
+			++num_event_actions;
+		}
+
+		std::string filename = StringPrintf("%s.%d", argv[2], static_cast<int>(shard));
+		if (!ActionLogFile::write(filename.c_str(), &out_vars, &out_scopes, &out_actions,
+				has_js ? &out_js : NULL, has_mem_values ? &out_mem_values : NULL,
+				FLAGS_compact ? ActionLogFile::COMPACT : ActionLogFile::COLUMNS)) {
+			fprintf(stderr, "Cannot write %s\n", filename.c_str());
+			return 1;
+		}
+		printf("Wrote %s: event actions %d-%d (%d), %d arcs, %d vars, %d scopes\n",
+				filename.c_str(), begin, end - 1, num_event_actions, num_arcs,
+				out_vars.numEntries(), out_scopes.numEntries());
+	}
+	return 0;
+}
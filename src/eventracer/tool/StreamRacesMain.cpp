@@ -0,0 +1,96 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Finds the races of an ER_actionlog file without loading its commands in memory.
+// The event actions are streamed into the variable access collection, the event
+// graph construction and the call trace builder, then the races are computed as usual.
+// The event graph fixes done by the web application are not applied, because they
+// need random access to the commands.
+
+#include <stdio.h>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "base.h"
+#include "ActionLogStream.h"
+#include "CallTraceBuilder.h"
+#include "EventGraph.h"
+#include "EventGraphBuilder.h"
+#include "StringSet.h"
+#include "TimerGraph.h"
+#include "VarsInfo.h"
+
+DEFINE_bool(print_races, true, "Print the races that are not covered by other races.");
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <ER_actionlog file>\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, scopes, js, mem_values;
+	VarsInfo vinfo;
+	SimpleDirectedGraph graph;
+	CallTraceBuilder call_traces;
+	VarAccessCollector access_collector(&vinfo);
+	EventGraphBuilder graph_builder(&graph);
+
+	ActionLogStream stream;
+	stream.addConsumer(&access_collector);
+	stream.addConsumer(&graph_builder);
+	stream.addConsumer(&call_traces);
+
+	fprintf(stderr, "Warning: the event graph fixes of raceanalyzer are not applied, "
+			"so the races can differ from raceanalyzer's.\n");
+	printf("Streaming %s...\n", argv[1]);
+	int64 start_time = GetCurrentTimeMicros();
+	if (!stream.run(argv[1], &vars, &scopes, &js, &mem_values)) {
+		fprintf(stderr, "Failed reading %s\n", argv[1]);
+		return 1;
+	}
+	printf("Streamed %d event actions with %lld commands in %lld ms.\n",
+			stream.numEventActions(), stream.numCommands(),
+			(GetCurrentTimeMicros() - start_time) / 1000);
+	printf("Created graph with %d nodes, %d arcs.\n",
+			graph.numNodes(), static_cast<int>(graph_builder.arcs().size()));
+
+	SimpleDirectedGraph graph_with_timers = graph;
+	TimerGraph timer_graph(graph_builder.arcs(), graph_with_timers);
+	timer_graph.build(&graph_with_timers);
+
+	start_time = GetCurrentTimeMicros();
+	vinfo.findRaces(graph_with_timers);
+	printf("Found %d races in %lld ms.\n", static_cast<int>(vinfo.races().size()),
+			(GetCurrentTimeMicros() - start_time) / 1000);
+
+	if (FLAGS_print_races) {
+		const VarsInfo::AllVarData& variables = vinfo.variables();
+		for (VarsInfo::AllVarData::const_iterator it = variables.begin(); it != variables.end(); ++it) {
+			const std::vector<int>& races = it->second.m_noParentRaces;
+			for (size_t i = 0; i < races.size(); ++i) {
+				const VarsInfo::RaceInfo& race = vinfo.races()[races[i]];
+				printf("%s %s %d -> %d (created by %d, %d)\n",
+						vars.getString(it->first), race.TypeShortStr(),
+						race.m_event1, race.m_event2,
+						call_traces.eventCreatedBy(race.m_event1),
+						call_traces.eventCreatedBy(race.m_event2));
+			}
+		}
+	}
+	return 0;
+}
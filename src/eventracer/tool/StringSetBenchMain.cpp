@@ -0,0 +1,105 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Measures StringSet insertion and lookup speed on the variable and value
+// dictionaries of an ER_actionlog file.
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+
+#include "ActionLogFile.h"
+#include "StringSet.h"
+#include "base.h"
+
+DEFINE_int32(rounds, 5, "Number of times to repeat each measurement.");
+
+namespace {
+
+// Returns the strings of a set in the order of their indices.
+void CollectStrings(const StringSet& set, std::vector<std::string>* strings) {
+	int pos = 0;
+	for (int i = 0; i < set.numEntries(); ++i) {
+		const char* s = set.getString(pos);
+		strings->push_back(s);
+		pos += strlen(s) + 1;
+	}
+}
+
+void Benchmark(const char* name, const StringSet& set) {
+	std::vector<std::string> strings;
+	CollectStrings(set, &strings);
+	std::vector<std::string> missing(strings);
+	for (size_t i = 0; i < missing.size(); ++i) missing[i].append("#");
+	size_t bytes = 0;
+	for (size_t i = 0; i < strings.size(); ++i) bytes += strings[i].size() + 1;
+	printf("%s: %d strings, %d bytes\n", name, static_cast<int>(strings.size()), static_cast<int>(bytes));
+
+	int64 insert_time = 0, hit_time = 0, miss_time = 0, add_existing_time = 0;
+	int checksum = 0;
+	for (int round = 0; round < FLAGS_rounds; ++round) {
+		StringSet copy;
+		int64 start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < strings.size(); ++i) checksum += copy.addString(strings[i].c_str());
+		insert_time += GetCurrentTimeMicros() - start_time;
+
+		start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < strings.size(); ++i) checksum += copy.findString(strings[i].c_str());
+		hit_time += GetCurrentTimeMicros() - start_time;
+
+		start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < missing.size(); ++i) checksum += copy.findString(missing[i].c_str());
+		miss_time += GetCurrentTimeMicros() - start_time;
+
+		// EventGraphFixer adds strings that are mostly present already.
+		start_time = GetCurrentTimeMicros();
+		for (size_t i = 0; i < strings.size(); ++i) checksum += copy.addString(strings[i].c_str());
+		add_existing_time += GetCurrentTimeMicros() - start_time;
+	}
+	double n = static_cast<double>(strings.size()) * FLAGS_rounds;
+	if (n == 0) return;
+	printf("  insert        %8.1f ns/string\n", insert_time * 1000.0 / n);
+	printf("  find (hit)    %8.1f ns/string\n", hit_time * 1000.0 / n);
+	printf("  find (miss)   %8.1f ns/string\n", miss_time * 1000.0 / n);
+	printf("  add existing  %8.1f ns/string\n", add_existing_time * 1000.0 / n);
+	printf("  (checksum %d)\n", checksum);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	google::ParseCommandLineFlags(&argc, &argv, true);
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <ER_actionlog>\n", argv[0]);
+		return 1;
+	}
+
+	StringSet vars, mem_values;
+	ActionLogFile file;
+	if (!file.open(argv[1]) ||
+			!file.loadStrings(ActionLogFile::VARS, &vars) ||
+			(file.hasSection(ActionLogFile::MEM_VALUES) && !file.loadStrings(ActionLogFile::MEM_VALUES, &mem_values))) {
+		fprintf(stderr, "Cannot read %s\n", argv[1]);
+		return 1;
+	}
+
+	Benchmark("vars", vars);
+	Benchmark("values", mem_values);
+	return 0;
+}
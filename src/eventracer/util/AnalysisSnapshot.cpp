@@ -0,0 +1,167 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "AnalysisSnapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "base.h"
+#include "serialize.h"
+
+#include "ActionLog.h"
+#include "EventGraph.h"
+#include "StringSet.h"
+#include "VarsInfo.h"
+
+#include "gflags/gflags.h"
+
+DEFINE_bool(erindex, true, "Save the analysis of a log in a .erindex file next to it and "
+		"use it instead of analyzing the log again, unless the log has changed.");
+
+namespace {
+
+const char kMagic[8] = "ERINDEX";
+const int kVersion = 7;
+
+// Identifies the version of a log file and the analysis options.
+struct SnapshotKey {
+	int64 m_logSize;
+	int64 m_logModifiedSec;
+	int64 m_logModifiedNsec;
+	std::string m_options;
+};
+
+bool GetSnapshotKey(const std::string& log_file, const std::string& options, SnapshotKey* key) {
+	struct stat st;
+	if (stat(log_file.c_str(), &st) != 0) return false;
+	key->m_logSize = st.st_size;
+	key->m_logModifiedSec = st.st_mtim.tv_sec;
+	key->m_logModifiedNsec = st.st_mtim.tv_nsec;
+	key->m_options = options;
+	return true;
+}
+
+}  // namespace
+
+AnalysisSnapshot::AnalysisSnapshot() : m_dataPos(0) {
+}
+
+std::string AnalysisSnapshot::snapshotFileName(const std::string& log_file) {
+	return log_file + ".erindex";
+}
+
+bool AnalysisSnapshot::open(const std::string& log_file, const std::string& options) {
+	m_file.close();
+	SnapshotKey key;
+	if (!GetSnapshotKey(log_file, options, &key)) return false;
+	std::string filename = snapshotFileName(log_file);
+	if (!m_file.open(filename.c_str())) return false;
+
+	const char* data = m_file.data();
+	size_t size = m_file.size();
+	size_t pos = 0;
+	char magic[sizeof(kMagic)];
+	int version;
+	SnapshotKey file_key;
+	if (!ReadValue(data, size, &pos, &magic) || memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+			!ReadValue(data, size, &pos, &version) || version != kVersion ||
+			!ReadValue(data, size, &pos, &file_key.m_logSize) ||
+			!ReadValue(data, size, &pos, &file_key.m_logModifiedSec) ||
+			!ReadValue(data, size, &pos, &file_key.m_logModifiedNsec) ||
+			!ReadString(data, size, &pos, &file_key.m_options)) {
+		fprintf(stderr, "Invalid snapshot %s\n", filename.c_str());
+		m_file.close();
+		return false;
+	}
+	if (file_key.m_logSize != key.m_logSize ||
+			file_key.m_logModifiedSec != key.m_logModifiedSec ||
+			file_key.m_logModifiedNsec != key.m_logModifiedNsec ||
+			file_key.m_options != key.m_options) {
+		printf("AnalysisSnapshot: %s is stale\n", filename.c_str());
+		m_file.close();
+		return false;
+	}
+	m_dataPos = pos;
+	return true;
+}
+
+bool AnalysisSnapshot::load(ThreadPool* pool, ActionLog* actions, StringSet* vars,
+		SimpleDirectedGraph* input_graph, SimpleDirectedGraph* graph_with_timers,
+		VarsInfo* vinfo) {
+	if (!m_file.isOpen()) return false;
+	int64 start_time = GetCurrentTimeMicros();
+	const char* data = m_file.data();
+	size_t size = m_file.size();
+	size_t pos = m_dataPos;
+	bool result =
+			actions->loadFromMemory(data, size, &pos, pool) &&
+			vars->loadIndexedFromMemory(data, size, &pos) &&
+			input_graph->loadFromMemory(data, size, &pos) &&
+			graph_with_timers->loadFromMemory(data, size, &pos) &&
+			vinfo->loadFromMemory(data, size, &pos) &&
+			pos == size;
+	m_file.close();
+	if (!result) {
+		fprintf(stderr, "Invalid snapshot data\n");
+		// The string sets replace their contents when loaded, the other outputs are reset.
+		*actions = ActionLog();
+		*input_graph = SimpleDirectedGraph();
+		*graph_with_timers = SimpleDirectedGraph();
+		return false;
+	}
+	printf("AnalysisSnapshot: Loaded (%lld ms)\n", (GetCurrentTimeMicros() - start_time) / 1000);
+	return true;
+}
+
+bool AnalysisSnapshot::save(const std::string& log_file, const std::string& options,
+		ActionLog* actions, StringSet* vars,
+		const SimpleDirectedGraph& input_graph, const SimpleDirectedGraph& graph_with_timers,
+		const VarsInfo& vinfo) {
+	if (vinfo.timedOut()) return false;
+	SnapshotKey key;
+	if (!GetSnapshotKey(log_file, options, &key)) return false;
+	int64 start_time = GetCurrentTimeMicros();
+	std::string filename = snapshotFileName(log_file);
+	// Write to a temporary file, so that a partially written snapshot is never used.
+	std::string tmp_filename = filename + ".tmp";
+	FILE* f = fopen(tmp_filename.c_str(), "wb");
+	if (!f) {
+		fprintf(stderr, "Cannot write snapshot %s\n", tmp_filename.c_str());
+		return false;
+	}
+	WriteValue(f, kMagic);
+	WriteValue(f, kVersion);
+	WriteValue(f, key.m_logSize);
+	WriteValue(f, key.m_logModifiedSec);
+	WriteValue(f, key.m_logModifiedNsec);
+	WriteString(f, key.m_options);
+	actions->saveToFile(f);
+	vars->saveIndexedToFile(f);
+	input_graph.saveToFile(f);
+	graph_with_timers.saveToFile(f);
+	vinfo.saveToFile(f);
+	bool result = !ferror(f);
+	result &= fclose(f) == 0;
+	if (!result || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+		fprintf(stderr, "Cannot write snapshot %s\n", filename.c_str());
+		remove(tmp_filename.c_str());
+		return false;
+	}
+	printf("AnalysisSnapshot: Saved %s (%lld ms)\n", filename.c_str(), (GetCurrentTimeMicros() - start_time) / 1000);
+	return true;
+}
@@ -0,0 +1,64 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef ANALYSISSNAPSHOT_H_
+#define ANALYSISSNAPSHOT_H_
+
+#include <string>
+
+#include "file.h"
+
+class ActionLog;
+class SimpleDirectedGraph;
+class StringSet;
+class ThreadPool;
+class VarsInfo;
+
+// A snapshot of the analysis of an ER_actionlog file: the actions, variables and
+// event graph after the graph fixes, the graph with timers, and the races with
+// their coverage and the index used for connectivity queries. It is stored in a
+// .erindex file next to the log, so that the analysis is not repeated when the same
+// log is opened again.
+class AnalysisSnapshot {
+public:
+	AnalysisSnapshot();
+
+	// Opens the snapshot of a log file. Returns false if there is no snapshot or it is
+	// stale, i.e. the log file changed or the snapshot was made with different options.
+	bool open(const std::string& log_file, const std::string& options);
+
+	// Loads an opened snapshot. The outputs must be empty. If the snapshot is invalid,
+	// returns false and leaves the outputs empty, except for vars, which is replaced
+	// when loaded again.
+	bool load(ThreadPool* pool, ActionLog* actions, StringSet* vars,
+			SimpleDirectedGraph* input_graph, SimpleDirectedGraph* graph_with_timers,
+			VarsInfo* vinfo);
+
+	// Saves the snapshot of a log file. Analysis results that timed out are not saved.
+	static bool save(const std::string& log_file, const std::string& options,
+			ActionLog* actions, StringSet* vars,
+			const SimpleDirectedGraph& input_graph, const SimpleDirectedGraph& graph_with_timers,
+			const VarsInfo& vinfo);
+
+	static std::string snapshotFileName(const std::string& log_file);
+
+private:
+	MappedFile m_file;
+	// The position of the data after the header.
+	size_t m_dataPos;
+};
+
+#endif /* ANALYSISSNAPSHOT_H_ */
@@ -23,52 +23,83 @@
 #include <utility>
 
 
-CallTraceBuilder::CallTraceBuilder() {
+CallTraceBuilder::CallTraceBuilder() : m_streaming(false) {
 }
 
 void CallTraceBuilder::Init(
 		const ActionLog& log,
 		const SimpleDirectedGraph& graph) {
-	const std::vector<ActionLog::Arc>& arcs = log.arcs();
-	std::vector<std::pair<int, int> > sorted_arcs;
-	sorted_arcs.reserve(arcs.size());
+	consumeArcs(log.arcs());
+	m_streaming = false;
+	initCauseEvents(graph.numNodes());
+
+	m_nodeTriggerPredecessors.assign(log.maxEventActionId() + 1, std::pair<int, int>(-1, -1));
+	m_parentScope.assign(log.maxEventActionId() + 1, std::vector<int>());
+	for (int op_id = 0; op_id <= log.maxEventActionId(); ++op_id) {
+		consumeEventAction(op_id, log.event_action(op_id));
+	}
+}
+
+void CallTraceBuilder::consumeArcs(const std::vector<ActionLog::Arc>& arcs) {
+	m_timedArcs.clear();
+	m_timedArcs.reserve(arcs.size());
 	for (size_t i = 0; i < arcs.size(); ++i) {
 		if (arcs[i].m_duration > 0) {
-			sorted_arcs.push_back(std::pair<int, int>(arcs[i].m_tail, arcs[i].m_head));
+			m_timedArcs.push_back(std::pair<int, int>(arcs[i].m_tail, arcs[i].m_head));
 		}
 	}
-	std::sort(sorted_arcs.begin(), sorted_arcs.end());
-	m_causeEvent.resize(graph.numNodes(), 0);
+	std::sort(m_timedArcs.begin(), m_timedArcs.end());
+	m_nodeTriggerPredecessors.clear();
+	m_parentScope.clear();
+	m_streaming = true;
+}
+
+void CallTraceBuilder::initCauseEvents(int num_nodes) {
+	m_causeEvent.resize(num_nodes, 0);
 	for (size_t i = 0; i < m_causeEvent.size(); ++i) {
 		m_causeEvent[i] = i;
 	}
-	for (size_t i = 0; i < sorted_arcs.size(); ++i) {
-		m_causeEvent[sorted_arcs[i].second] = m_causeEvent[sorted_arcs[i].first];
+	for (size_t i = 0; i < m_timedArcs.size(); ++i) {
+		m_causeEvent[m_timedArcs[i].second] = m_causeEvent[m_timedArcs[i].first];
 	}
+}
 
-	m_nodeTriggerPredecessors.assign(log.maxEventActionId() + 1, std::pair<int, int>(-1, -1));
-	m_parentScope.assign(log.maxEventActionId() + 1, std::vector<int>());
+void CallTraceBuilder::consumeEventAction(int op_id, const ActionLog::EventAction& op) {
+	// When streaming, the number of event actions is not known in advance.
+	if (op_id >= static_cast<int>(m_parentScope.size())) {
+		m_parentScope.resize(op_id + 1);
+	}
+	if (op_id >= static_cast<int>(m_nodeTriggerPredecessors.size())) {
+		m_nodeTriggerPredecessors.resize(op_id + 1, std::pair<int, int>(-1, -1));
+	}
 	std::vector<int> scope;
-	for (int op_id = 0; op_id <= log.maxEventActionId(); ++op_id) {
-		const ActionLog::EventAction& op = log.event_action(op_id);
-		scope.clear();
-		m_parentScope[op_id].assign(op.m_commands.size(), -1);
-		for (size_t cmd_id = 0; cmd_id < op.m_commands.size(); ++cmd_id) {
-			const ActionLog::Command& cmd = op.m_commands[cmd_id];
-			m_parentScope[op_id][cmd_id] = scope.empty() ? -1 : scope[scope.size() - 1];
-			if (cmd.m_cmdType == ActionLog::ENTER_SCOPE) {
-				scope.push_back(cmd_id);
-			} else if (cmd.m_cmdType == ActionLog::EXIT_SCOPE) {
-				if (!scope.empty()) { scope.pop_back(); }
-			} else if (cmd.m_cmdType == ActionLog::TRIGGER_ARC) {
-				if (cmd.m_location >= 0 && cmd.m_location < static_cast<int>(m_nodeTriggerPredecessors.size())) {
-					m_nodeTriggerPredecessors[cmd.m_location] = std::pair<int, int>(op_id, cmd_id);
-				}
+	m_parentScope[op_id].assign(op.m_commands.size(), -1);
+	for (size_t cmd_id = 0; cmd_id < op.m_commands.size(); ++cmd_id) {
+		const ActionLog::Command& cmd = op.m_commands[cmd_id];
+		m_parentScope[op_id][cmd_id] = scope.empty() ? -1 : scope[scope.size() - 1];
+		if (cmd.m_cmdType == ActionLog::ENTER_SCOPE) {
+			scope.push_back(cmd_id);
+		} else if (cmd.m_cmdType == ActionLog::EXIT_SCOPE) {
+			if (!scope.empty()) { scope.pop_back(); }
+		} else if (cmd.m_cmdType == ActionLog::TRIGGER_ARC) {
+			if (cmd.m_location >= static_cast<int>(m_nodeTriggerPredecessors.size()) && m_streaming) {
+				m_nodeTriggerPredecessors.resize(cmd.m_location + 1, std::pair<int, int>(-1, -1));
+			}
+			if (cmd.m_location >= 0 && cmd.m_location < static_cast<int>(m_nodeTriggerPredecessors.size())) {
+				m_nodeTriggerPredecessors[cmd.m_location] = std::pair<int, int>(op_id, cmd_id);
 			}
 		}
 	}
 }
 
+void CallTraceBuilder::finish(int max_event_action_id) {
+	// Drop the triggers of event actions after the last one, as Init does.
+	m_nodeTriggerPredecessors.resize(max_event_action_id + 1, std::pair<int, int>(-1, -1));
+	m_parentScope.resize(max_event_action_id + 1);
+	initCauseEvents(max_event_action_id + 1);
+	m_streaming = false;
+}
+
 int CallTraceBuilder::eventCreatedBy(int event_action_id) const {
 	return event_action_id < static_cast<int>(m_causeEvent.size()) ?
 			m_causeEvent[event_action_id] : event_action_id;
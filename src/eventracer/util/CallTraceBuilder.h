@@ -17,13 +17,16 @@
 #ifndef CallTraceBuilder_H_
 #define CallTraceBuilder_H_
 
+#include <utility>
 #include <vector>
 
-class ActionLog;
+#include "ActionLog.h"
+
 class SimpleDirectedGraph;
 
 // For every event, keeps the event action that forked the event.
-class CallTraceBuilder {
+// Can also be built from a streamed action log as an ActionLogConsumer.
+class CallTraceBuilder : public ActionLogConsumer {
 public:
 	CallTraceBuilder();
 
@@ -31,6 +34,10 @@ public:
 			const ActionLog& log,
 			const SimpleDirectedGraph& graph);
 
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs);
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action);
+	virtual void finish(int max_event_action_id);
+
 	// Returns the event action id that created a given event action.
 	int eventCreatedBy(int event_action_id) const;
 
@@ -42,6 +49,12 @@ public:
 	void getCallTraceOfCommand(int event_action_id, int command_id, std::vector<int>* call_trace) const;
 
 private:
+	void initCauseEvents(int num_nodes);
+
+	// Whether the event actions come from a stream and their number is not known yet.
+	bool m_streaming;
+	// Arcs with a duration, sorted.
+	std::vector<std::pair<int, int> > m_timedArcs;
 	std::vector<int> m_causeEvent;
 	std::vector<std::pair<int, int> > m_nodeTriggerPredecessors;
 	std::vector<std::vector<int> > m_parentScope;
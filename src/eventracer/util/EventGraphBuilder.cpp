@@ -0,0 +1,48 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "EventGraphBuilder.h"
+
+#include <stdio.h>
+
+EventGraphBuilder::EventGraphBuilder(SimpleDirectedGraph* graph) : m_graph(graph) {
+}
+
+void EventGraphBuilder::consumeArcs(const std::vector<ActionLog::Arc>& arcs) {
+	m_arcs = arcs;
+	int max_node = m_graph->numNodes() - 1;
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		if (arcs[i].m_head > max_node) max_node = arcs[i].m_head;
+		if (arcs[i].m_tail > max_node) max_node = arcs[i].m_tail;
+	}
+	m_graph->addNodesUpTo(max_node);
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		const ActionLog::Arc& arc = arcs[i];
+		if (arc.m_tail > arc.m_head) {
+			fprintf(stderr, "Unexpected backwards arc %d -> %d\n", arc.m_tail, arc.m_head);
+		}
+		m_graph->addArc(arc.m_tail, arc.m_head);
+	}
+}
+
+void EventGraphBuilder::consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action) {
+}
+
+void EventGraphBuilder::finish(int max_event_action_id) {
+	if (max_event_action_id >= m_graph->numNodes()) {
+		m_graph->addNodesUpTo(max_event_action_id);
+	}
+}
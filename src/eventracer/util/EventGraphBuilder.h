@@ -0,0 +1,42 @@
+/*
+   Copyright 2013 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef EVENTGRAPHBUILDER_H_
+#define EVENTGRAPHBUILDER_H_
+
+#include <vector>
+
+#include "ActionLog.h"
+#include "EventGraph.h"
+
+// Builds the event graph of a streamed action log. Keeps the arcs of the log,
+// because they are needed later to build the graph with timers.
+class EventGraphBuilder : public ActionLogConsumer {
+public:
+	explicit EventGraphBuilder(SimpleDirectedGraph* graph);
+
+	virtual void consumeArcs(const std::vector<ActionLog::Arc>& arcs);
+	virtual void consumeEventAction(int event_action_id, const ActionLog::EventAction& event_action);
+	virtual void finish(int max_event_action_id);
+
+	const std::vector<ActionLog::Arc>& arcs() const { return m_arcs; }
+
+private:
+	SimpleDirectedGraph* m_graph;
+	std::vector<ActionLog::Arc> m_arcs;
+};
+
+#endif /* EVENTGRAPHBUILDER_H_ */
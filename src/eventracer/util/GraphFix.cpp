@@ -111,8 +111,8 @@ void EventGraphFixer::addEventAfterTargetHappensBefore() {
 			if (cmd.m_cmdType == ActionLog::WRITE_MEMORY) {
 				if (getTargetNodeString(m_vars->getString(cmd.m_location), &node_id)) {
 					m_lastLoc[node_id] = event_action_id;
-					m_log->mutable_event_action(event_action_id)->m_commands[i].m_location =
-							m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), event_action_id).c_str());
+					m_log->setCommandLocation(event_action_id, i,
+							m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), event_action_id).c_str()));
 				}
 			} else if (cmd.m_cmdType == ActionLog::READ_MEMORY) {
 				if (getTargetNodeString(m_vars->getString(cmd.m_location), &node_id)) {
@@ -120,8 +120,8 @@ void EventGraphFixer::addEventAfterTargetHappensBefore() {
 					if (it != m_lastLoc.end()) {
 						if (m_eventGraph->addArcIfNeeded(it->second, event_action_id))
 							++num_arcs_added;
-						m_log->mutable_event_action(event_action_id)->m_commands[i].m_location =
-								m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), it->second).c_str());
+						m_log->setCommandLocation(event_action_id, i,
+								m_vars->addString(StringPrintf("%s-%d", m_vars->getString(cmd.m_location), it->second).c_str()));
 					}
 				}
 			}
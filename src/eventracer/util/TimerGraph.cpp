@@ -28,7 +28,7 @@ public:
 	}
 };
 
-TimerGraph::TimerGraph(const std::vector<ActionLog::Arc>& arcs, const SimpleDirectedGraph& graph) {
+TimerGraph::TimerGraph(const std::vector<ActionLog::Arc>& arcs, const DirectedGraphInterface& graph) {
 	int num_timed_arcs = 0;
 	for (size_t i = 0; i < arcs.size(); ++i) {
 		if (arcs[i].m_duration >= 0 &&
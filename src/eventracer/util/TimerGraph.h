@@ -24,7 +24,7 @@
 
 class TimerGraph {
 public:
-	explicit TimerGraph(const std::vector<ActionLog::Arc>& arcs, const SimpleDirectedGraph& graph);
+	explicit TimerGraph(const std::vector<ActionLog::Arc>& arcs, const DirectedGraphInterface& graph);
 
 	void build(SimpleDirectedGraph* graph);
 
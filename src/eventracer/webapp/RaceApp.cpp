@@ -20,8 +20,10 @@
 #include "base.h"
 #include "stringprintf.h"
 #include "strutil.h"
+#include "thread_pool.h"
 
 #include "ActionLogPrint.h"
+#include "AnalysisSnapshot.h"
 #include "Escaping.h"
 #include "EventGraphViz.h"
 #include "GraphFix.h"
@@ -39,6 +41,10 @@
 #include <utility>
 #include <queue>
 
+#include "gflags/gflags.h"
+
+DECLARE_bool(erindex);
+
 using std::string;
 
 namespace {
@@ -145,27 +151,52 @@ const char* VarTypeByName(const char* name) {
 
 RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_nodes)
 	: m_appId(app_id),
+	  m_jsLoaded(false),
 	  m_raceTags(m_vinfo, m_actions, m_vars, m_scopes, m_memValues, m_callTraceBuilder),
 	  m_fileName(actionLogFile) {
 	fprintf(stderr, "Loading %s... ", actionLogFile.c_str());
-	FILE* f = fopen(actionLogFile.c_str(), "rb");
-	if (!f) {
+	if (!m_logFile.open(actionLogFile.c_str())) {
 		fprintf(stderr, "Cannot open file %s\n", actionLogFile.c_str());
 		exit(1);
 		return;
 	}
-	m_vars.loadFromFile(f);
-	m_scopes.loadFromFile(f);
-	m_actions.loadFromFile(f);
-	if (!feof(f)) {
-		m_js.loadFromFile(f);
-	}
-	if (!feof(f)) {
-		m_memValues.loadFromFile(f);
+	std::string snapshot_options = StringPrintf("raceapp can_drop_nodes=%d %s",
+			can_drop_nodes, VarsInfo::analysisOptions().c_str());
+	AnalysisSnapshot snapshot;
+	bool from_snapshot = FLAGS_erindex && snapshot.open(actionLogFile, snapshot_options);
+	// The JavaScript code is only loaded when needed, see js().
+	{
+		ThreadPool pool;
+		if (from_snapshot) {
+			m_logFile.load(NULL, &m_scopes, NULL, NULL, &m_memValues, &pool);
+			from_snapshot = snapshot.load(&pool, &m_actions, &m_vars, &m_inputEventGraph, &m_graphWithTimers, &m_vinfo);
+			if (!from_snapshot) m_logFile.load(&m_vars, NULL, &m_actions, NULL, NULL, &pool);
+		} else {
+			m_logFile.load(&m_vars, &m_scopes, &m_actions, NULL, &m_memValues, &pool);
+		}
 	}
-	fclose(f);
 	fprintf(stderr, "DONE\n");
 
+	if (from_snapshot) {
+		// The fixes only change the locations of memory accesses and the graph, so the
+		// call traces and the graph info are rebuilt from the snapshot.
+		m_callTraceBuilder.Init(m_actions, m_inputEventGraph);
+		m_graphInfo.init(m_actions);
+		for (int i = 0; i < m_inputEventGraph.numNodes(); ++i) {
+			if (m_inputEventGraph.isNodeDeleted(i)) m_graphInfo.dropNode(i);
+		}
+	} else {
+		analyze(can_drop_nodes);
+		if (FLAGS_erindex) {
+			AnalysisSnapshot::save(actionLogFile, snapshot_options, &m_actions, &m_vars,
+					m_inputEventGraph, m_graphWithTimers, m_vinfo);
+		}
+	}
+
+	m_actionPrinter = new ActionLogPrinter(&m_actions, &m_vars, &m_scopes, &m_memValues);
+}
+
+void RaceApp::analyze(bool can_drop_nodes) {
 	m_inputEventGraph.addNodesUpTo(m_actions.maxEventActionId());
 	int num_arcs = 0;
 	for (size_t i = 0; i < m_actions.arcs().size(); ++i) {
@@ -199,10 +230,8 @@ RaceApp::RaceApp(int64 app_id, const std::string& actionLogFile, bool can_drop_n
 
 	printf("Checking for races...\n");
 	start_time = GetCurrentTimeMicros();
-	m_vinfo.findRaces(m_actions, m_graphWithTimers);
+	m_vinfo.findRaces(m_graphWithTimers);
 	printf("Done checking for races (%lld ms)...\n", (GetCurrentTimeMicros() - start_time) / 1000);
-
-	m_actionPrinter = new ActionLogPrinter(&m_actions, &m_vars, &m_scopes, &m_memValues);
 }
 
 RaceApp::~RaceApp() {
@@ -573,7 +602,7 @@ void RaceApp::handleShowJS(const std::string& params, std::string* response) {
 	URLParams p;
 	p.parse(params);
 	int jsid = p.getIntDefault("jsid", 0);
-	std::string js(m_js.getString(jsid));
+	std::string js(this->js().getString(jsid));
 	addHeader(response, StringPrintf("Javascript #%d", jsid));
 	response->append("<pre>");
 	JsViewer jsviewer;
@@ -1033,6 +1062,17 @@ void RaceApp::printVarAccessCallTrace(
 	}
 }
 
+const StringSet& RaceApp::js() {
+	lock_guard<mutex> lock(m_jsMutex);
+	if (!m_jsLoaded) {
+		if (m_logFile.hasSection(ActionLogFile::JS)) {
+			m_logFile.loadStrings(ActionLogFile::JS, &m_js);
+		}
+		m_jsLoaded = true;
+	}
+	return m_js;
+}
+
 bool RaceApp::getAccessValue(int event_action_id, int command_id, std::string* value) const {
 	const ActionLog::EventAction& event = m_actions.event_action(event_action_id);
 	if (command_id + 1 < static_cast<int>(event.m_commands.size()) &&
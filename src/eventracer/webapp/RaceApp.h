@@ -20,11 +20,13 @@
 #include <string>
 #include <vector>
 #include "base.h"
+#include "mutex.h"
 #include "CallTraceBuilder.h"
 #include "EventGraph.h"
 #include "EventGraphInfo.h"
 #include "StringSet.h"
 #include "ActionLog.h"
+#include "ActionLogFile.h"
 #include "VarsInfo.h"
 #include "RaceTags.h"
 
@@ -63,6 +65,9 @@ public:
 	const VarsInfo& vinfo() const { return m_vinfo; }
 	const StringSet& vars() const { return m_vars; }
 private:
+	// Runs the graph fixes and the race detection on the loaded log.
+	void analyze(bool can_drop_nodes);
+
 	int getVarFilterLevel(int var_id, const VarsInfo::VarData& data) const;
 
 	void showEventsSummariesIntoTable(const std::vector<int>& events, std::string* response);
@@ -93,12 +98,18 @@ private:
 
 	bool getAccessValue(int event_action_id, int command_id, std::string* value) const;
 
+	// Returns the JavaScript code, loading it from the file on first use.
+	const StringSet& js();
+
 	int64 m_appId;
 
+	ActionLogFile m_logFile;
 	ActionLog m_actions;
 	StringSet m_vars;
 	StringSet m_scopes;
 	StringSet m_js;
+	bool m_jsLoaded;
+	mutex m_jsMutex;
 	StringSet m_memValues;
 
 	VarsInfo m_vinfo;
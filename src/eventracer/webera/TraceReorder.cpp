@@ -75,7 +75,7 @@ void TraceReorder::SaveSchedule(const char* filename, const std::vector<int>& sc
 bool TraceReorder::GetScheduleFromRaces(
 		const VarsInfo& vinfo,
 		const std::vector<int>& rev_races,
-		const SimpleDirectedGraph& graph,
+		const DirectedGraphInterface& graph,
 		const Options& options,
 		std::vector<int>* schedule) const {
 
@@ -136,7 +136,7 @@ bool TraceReorder::GetScheduleFromRaces(
 bool TraceReorder::GetSchedule(
 		const std::vector<Reverse>& reverses,
 		const std::vector<Preserve>& preserves,
-		const SimpleDirectedGraph& graph,
+		const DirectedGraphInterface& graph,
 		const Options& options,
 		std::vector<int>* schedule) const {
 
@@ -157,7 +157,7 @@ bool TraceReorder::GetSchedule(
 
 	std::set<int> to_output;
 	for (int node_id = 0; node_id < graph.numNodes(); ++node_id) {
-		const std::vector<int>& succs1 = graph.nodeSuccessors(node_id);
+		NodeSpan succs1 = graph.successors(node_id);
 		for (size_t i = 0; i < succs1.size(); ++i) {
 			if (succs1[i] < node_id) fprintf(stderr, "Reverse arc\n");
 			++in_degree[succs1[i]];
@@ -195,7 +195,7 @@ bool TraceReorder::GetSchedule(
 				to_output.erase(node_id);
 				schedule->push_back(node_id);
 				++num_output;
-				const std::vector<int>& succs1 = graph.nodeSuccessors(node_id);
+				NodeSpan succs1 = graph.successors(node_id);
 				for (size_t i = 0; i < succs1.size(); ++i) {
 					--in_degree[succs1[i]];
 				}
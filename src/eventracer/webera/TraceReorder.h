@@ -64,14 +64,14 @@ public:
 	bool GetScheduleFromRaces(
 			const VarsInfo& vinfo,
 			const std::vector<int>& rev_races,
-			const SimpleDirectedGraph& graph,
+			const DirectedGraphInterface& graph,
 			const Options& options,
 			std::vector<int>* schedule) const;
 
 	bool GetSchedule(
 			const std::vector<Reverse>& reverses,
 			const std::vector<Preserve>& preserves,
-			const SimpleDirectedGraph& graph,
+			const DirectedGraphInterface& graph,
 			const Options& options,
 			std::vector<int>* schedule) const;
 